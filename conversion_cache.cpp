@@ -0,0 +1,142 @@
+#include "conversion_cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#include "errors.h"
+
+using namespace std;
+
+// temporary files of writers that crashed are removed after this many seconds
+static const time_t STALE_SECONDS = 24 * 60 * 60;
+
+// FNV-1a with the 128-bit parameters, the prime is 2^88 + 0x13b
+static string fnv1a_128(const string &data) {
+    unsigned __int128 hash = ((unsigned __int128)0x6c62272e07bb0142ULL << 64) |
+                             0x62b821756295c58dULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash = (hash << 88) + hash * 0x13b;
+    }
+    char hex[33];
+    snprintf(hex, sizeof(hex), "%016llx%016llx",
+             (unsigned long long)(hash >> 64), (unsigned long long)hash);
+    return hex;
+}
+
+string cache_key(const TuringMachine &tm, const ConversionOptions &options) {
+    ostringstream canonical;
+    canonical << CONVERSION_VERSION << " " << options.fused << " "
+              << options.codewordBase << " " << options.inPlace << " "
+              << options.blockSize << " " << options.keepTapes << "\n"
+              << tm;
+    return fnv1a_128(canonical.str());
+}
+
+void open_cache(const string &dir) {
+    error_code error;
+    filesystem::create_directories(dir, error);
+    if (error || !filesystem::is_directory(dir))
+        fatal("Cannot create the cache directory " + dir);
+}
+
+static string entry_path(const string &dir, const string &key) {
+    return dir + "/" + key + ".tm";
+}
+
+// copies everything from one descriptor to the other
+static bool copy_data(int from, int to) {
+    char buffer[1 << 16];
+    for (;;) {
+        ssize_t got = read(from, buffer, sizeof(buffer));
+        if (got == 0) return true;
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        for (ssize_t done = 0; done < got;) {
+            ssize_t put = write(to, buffer + done, got - done);
+            if (put < 0 && errno != EINTR) return false;
+            if (put > 0) done += put;
+        }
+    }
+}
+
+bool fetch_from_cache(const string &dir, const string &key,
+                      const string &path) {
+    // once opened the entry can be evicted by others without harm
+    int entry = open(entry_path(dir, key).c_str(), O_RDONLY);
+    if (entry < 0) return false;
+    int output = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (output < 0) fatal("Cannot write " + path);
+    bool ok = copy_data(entry, output);
+    ok = close(output) == 0 && ok;
+    if (!ok) fatal("Cannot write " + path);
+    // the modification time orders the entries for eviction
+    futimens(entry, nullptr);
+    close(entry);
+    return true;
+}
+
+// removes the oldest entries above the limit and stale temporary files
+static void evict(const string &dir, uint64_t max_bytes) {
+    vector<tuple<time_t, long, uint64_t, string>> entries;
+    uint64_t total = 0;
+    time_t now = time(nullptr);
+    error_code error;
+    for (const auto &file : filesystem::directory_iterator(dir, error)) {
+        struct stat st;
+        string name = file.path().filename();
+        if (stat(file.path().c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        if (name.ends_with(".tm")) {
+            entries.emplace_back(st.st_mtim.tv_sec, st.st_mtim.tv_nsec,
+                                 st.st_size, file.path());
+            total += st.st_size;
+        } else if (name.find(".tmp.") != string::npos &&
+                   now - st.st_mtime > STALE_SECONDS) {
+            unlink(file.path().c_str());
+        }
+    }
+    sort(entries.begin(), entries.end());
+    for (const auto &[seconds, nanoseconds, size, path] : entries) {
+        if (total <= max_bytes) break;
+        // another converter may have removed it already
+        unlink(path.c_str());
+        total -= size;
+    }
+}
+
+void store_in_cache(const string &dir, const string &key, const string &path,
+                    uint64_t max_bytes) {
+    int input = open(path.c_str(), O_RDONLY);
+    if (input < 0) return;
+    string tmp_path = dir + "/" + key + ".tmp.XXXXXX";
+    int tmp = mkstemp(tmp_path.data());
+    if (tmp < 0) {
+        close(input);
+        return;
+    }
+    fchmod(tmp, 0644);
+    bool ok = copy_data(input, tmp) && fsync(tmp) == 0;
+    ok = close(tmp) == 0 && ok;
+    close(input);
+    // a concurrent converter storing the same key renames an equal file
+    if (!ok || rename(tmp_path.c_str(), entry_path(dir, key).c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return;
+    }
+    evict(dir, max_bytes);
+}
@@ -0,0 +1,32 @@
+#ifndef __CONVERSION_CACHE_H
+#define __CONVERSION_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "turing_machine.h"
+
+// A directory of converted machines named by the hash of their source machine
+// and the options of the conversion. Entries are written to a temporary file
+// and renamed, so concurrent converters never see a partial entry; the least
+// recently used entries are removed once the directory grows over its limit.
+
+// hex digits of a 128-bit hash of the canonical form of the machine (sorted
+// transitions and the input alphabet), the options and CONVERSION_VERSION
+std::string cache_key(const TuringMachine &tm,
+                      const ConversionOptions &options);
+
+// the directory is created if needed
+void open_cache(const std::string &dir);
+
+// copies the entry to the path and marks it as recently used, false if there
+// is no such entry; the path is truncated, so it should be a temporary file
+bool fetch_from_cache(const std::string &dir, const std::string &key,
+                      const std::string &path);
+
+// copies the file at the path into the cache and evicts entries until at most
+// max_bytes are stored; failures only leave the entry out of the cache
+void store_in_cache(const std::string &dir, const std::string &key,
+                    const std::string &path, uint64_t max_bytes);
+
+#endif
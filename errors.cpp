@@ -0,0 +1,32 @@
+#include "errors.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+void fatal(const string &message) {
+    cerr << "ERROR: " << message << "\n";
+    exit(1);
+}
+
+uint64_t parse_integer(const string &option, const string &value,
+                       void (*print_usage)(string), uint64_t min,
+                       uint64_t max) {
+    // stoull would also take spaces and a minus sign in front
+    if (!value.empty() && isdigit((unsigned char)value[0])) {
+        try {
+            size_t last;
+            unsigned long long number = stoull(value, &last);
+            if (last == value.length() && number >= min && number <= max)
+                return number;
+        } catch (...) {
+        }
+    }
+    if (min == 0 && max == UINT64_MAX)
+        print_usage("Non-negative integer expected after " + option);
+    print_usage("Integer between " + to_string(min) + " and " +
+                to_string(max) + " expected after " + option);
+    exit(1);
+}
@@ -0,0 +1,16 @@
+#ifndef __ERRORS_H
+#define __ERRORS_H
+
+#include <cstdint>
+#include <string>
+
+// prints "ERROR: " followed by the message and exits with 1
+[[noreturn]] void fatal(const std::string &message);
+
+// the value of a command line option as a decimal integer between min and
+// max, anything else is reported through print_usage, which must not return
+uint64_t parse_integer(const std::string &option, const std::string &value,
+                       void (*print_usage)(std::string), uint64_t min = 0,
+                       uint64_t max = UINT64_MAX);
+
+#endif
@@ -0,0 +1,7 @@
+num-tapes: 1
+input-alphabet: a b
+(start) a (start) a >
+(start) _ (accept) _ -
+(start) x (reject) x -
+(start) b (mark) x >
+(mark) _ (mark) x >
@@ -0,0 +1,8 @@
+num-tapes: 2
+input-alphabet: a b
+(start) a _ (q1) a M > >
+(q1) a _ (q1) a x > >
+(q1) b _ (q2) b _ - <
+(q2) b x (q2) b x > <
+(q2) b M (q3) b M > -
+(q3) _ M (accept) _ M - -
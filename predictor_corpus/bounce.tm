@@ -0,0 +1,14 @@
+num-tapes: 2
+input-alphabet: a b
+(start) a _ (q1) b a > >
+(q1) a a (q2) a a - <
+(q1) b _ (q2) b _ < -
+(q1) _ _ (q2) x _ < >
+(q2) b a (start) a _ - -
+(q2) a _ (q1) a _ > -
+(q2) b _ (start) a _ - -
+(q2) a a (q1) a a > -
+(q2) x _ (accept) _ _ - -
+(start) b _ (q1) a _ > -
+(start) a a (q1) b a > -
+(start) b a (q1) b _ > <
@@ -0,0 +1,19 @@
+num-tapes: 2
+input-alphabet: a b
+(start) _ _ (accept) _ _ - -
+(start) a _ (cp) a M - >
+(start) b _ (cp) b M - >
+(cp) a _ (cp) a a > >
+(cp) b _ (cp) b b > >
+(rw) _ b (rw) _ b < <
+(rw) _ a (rw) _ a < <
+(rw) b b (rw) b b < <
+(rw) b a (rw) b a < <
+(rw) a b (rw) a b < <
+(rw) a a (rw) a a < <
+(cp) _ _ (rw) _ _ - <
+(rw) a M (cmp) a M - >
+(rw) b M (cmp) b M - >
+(cmp) a a (cmp) a a > >
+(cmp) b b (cmp) b b > >
+(cmp) _ _ (accept) _ _ - -
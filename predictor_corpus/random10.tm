@@ -0,0 +1,17 @@
+num-tapes: 2
+input-alphabet: a b
+(start) a a (start) _ b > <
+(start) a _ (start) b _ > >
+(start) a x (start) _ b < >
+(start) b a (accept) a b > >
+(start) b b (start) x x - -
+(start) b _ (start) b a > >
+(start) b x (start) b x > -
+(start) _ a (start) x b > >
+(start) _ b (start) _ b > <
+(start) _ _ (start) b x > <
+(start) _ x (start) _ b > <
+(start) x a (start) _ x > >
+(start) x b (start) x _ > <
+(start) x _ (start) a a < <
+(start) x x (start) b x > >
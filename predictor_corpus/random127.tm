@@ -0,0 +1,15 @@
+num-tapes: 2
+input-alphabet: a b (c)
+(start) a a (start) _ b - >
+(start) a (c) (reject) (c) a > <
+(start) a _ (start) a _ > >
+(start) b a (start) (c) a > <
+(start) b b (start) b _ > -
+(start) (c) a (start) b _ - >
+(start) (c) b (start) a (c) > >
+(start) (c) (c) (start) _ a - -
+(start) (c) _ (start) _ b > >
+(start) _ a (start) (c) _ > >
+(start) _ b (start) b a > >
+(start) _ (c) (start) (c) (c) > >
+(start) _ _ (start) a a > <
@@ -0,0 +1,11 @@
+num-tapes: 2
+input-alphabet: a
+(start) a a (start) a x < <
+(start) a _ (start) a a > >
+(start) a x (start) x _ - >
+(start) _ a (start) x x < -
+(start) _ _ (accept) _ _ < -
+(start) _ x (start) x x > -
+(start) x a (start) a a > >
+(start) x _ (start) a _ > >
+(start) x x (start) a _ > -
@@ -0,0 +1,6 @@
+num-tapes: 2
+input-alphabet: a
+(start) a a (start) _ a - >
+(start) a _ (start) a a > -
+(start) _ a (start) _ _ > <
+(start) _ _ (start) _ _ < >
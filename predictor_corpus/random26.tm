@@ -0,0 +1,26 @@
+num-tapes: 2
+input-alphabet: a b (c)
+(start) a a (start) _ a > >
+(start) a b (start) _ b > >
+(start) a (c) (start) b b > >
+(start) b a (start) a (c) > >
+(start) b b (q1) (c) (c) > -
+(start) b (c) (q1) b _ > >
+(start) b _ (start) a a > >
+(start) (c) _ (start) _ _ > <
+(start) _ a (start) (c) (c) > >
+(start) _ b (q1) (c) _ > >
+(start) _ _ (accept) a _ < >
+(q1) a a (accept) _ a > >
+(q1) a b (start) a _ > >
+(q1) a (c) (q1) _ a < >
+(q1) a _ (q1) _ (c) > >
+(q1) b a (start) a b > >
+(q1) b b (q1) b a > >
+(q1) b (c) (accept) b a - -
+(q1) (c) a (start) a a - -
+(q1) (c) b (start) a a > -
+(q1) (c) (c) (q1) (c) (c) > >
+(q1) _ a (q1) a (c) < >
+(q1) _ (c) (q1) b b > >
+(q1) _ _ (q1) b _ < >
@@ -0,0 +1,39 @@
+num-tapes: 2
+input-alphabet: a b
+(start) a a (start) a x > >
+(start) a x (start) b _ > >
+(start) b a (q2) x a > <
+(start) b _ (q2) _ a < >
+(start) b x (q2) _ a > >
+(start) _ a (start) b x > <
+(start) _ b (start) x a > -
+(start) _ _ (accept) _ _ < >
+(start) _ x (start) a _ > <
+(start) x a (q2) b x < >
+(start) x b (start) b a > <
+(start) x x (q2) x x > >
+(q1) a b (start) a _ > >
+(q1) a _ (q1) x b > >
+(q1) b a (accept) x a > >
+(q1) b _ (start) b b > <
+(q1) b x (q2) _ _ > >
+(q1) _ b (reject) x x > <
+(q1) _ _ (start) a _ > -
+(q1) _ x (start) x _ > >
+(q1) x a (q1) a b > >
+(q1) x _ (q2) _ _ > >
+(q1) x x (q2) _ x > >
+(q2) a a (accept) a a > >
+(q2) a b (q1) _ x > >
+(q2) a _ (start) x _ - -
+(q2) a x (q2) x x > -
+(q2) b a (start) _ b - <
+(q2) b b (q1) b _ > <
+(q2) b _ (q2) x x > -
+(q2) b x (start) _ a > >
+(q2) _ a (q2) b _ > <
+(q2) _ b (start) x x > >
+(q2) _ _ (start) x _ > -
+(q2) _ x (q2) x b > <
+(q2) x a (reject) b a > >
+(q2) x x (q1) b x > -
@@ -0,0 +1,30 @@
+num-tapes: 2
+input-alphabet: a b
+(start) a a (start) b b > >
+(start) a b (accept) x x - >
+(start) a _ (start) _ x > >
+(start) a x (start) x x < -
+(start) b a (start) b a > -
+(start) b b (q1) x _ > >
+(start) b _ (start) _ _ > >
+(start) b x (start) _ _ > -
+(start) _ b (start) _ _ < >
+(start) _ _ (q1) b x - >
+(start) _ x (start) _ a > <
+(start) x a (start) x x < >
+(start) x b (start) a _ - <
+(start) x x (accept) b _ - >
+(q1) a a (start) x b - -
+(q1) a b (q1) x a - >
+(q1) a _ (start) x b > >
+(q1) a x (q1) _ x < <
+(q1) b a (start) _ x > >
+(q1) b b (start) b _ > >
+(q1) b _ (accept) _ a > >
+(q1) _ a (q1) _ _ > >
+(q1) _ _ (start) b x - >
+(q1) _ x (q1) _ _ > -
+(q1) x a (start) a x > >
+(q1) x b (q1) _ _ > >
+(q1) x _ (q1) b _ < >
+(q1) x x (start) _ x > >
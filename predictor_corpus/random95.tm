@@ -0,0 +1,19 @@
+num-tapes: 2
+input-alphabet: a b
+(start) a a (accept) a _ < -
+(start) a b (start) b b > <
+(start) a _ (q1) _ a > >
+(start) b a (start) _ b > <
+(start) b b (q1) b b - >
+(start) b _ (start) _ a < >
+(start) _ a (start) _ _ - >
+(start) _ b (start) b b > >
+(start) _ _ (start) b a < -
+(q1) a a (start) b _ > >
+(q1) a _ (q1) a a > >
+(q1) b a (start) _ _ > -
+(q1) b b (reject) b _ < >
+(q1) b _ (start) b a > >
+(q1) _ a (q1) a a - >
+(q1) _ b (q1) b _ < >
+(q1) _ _ (q1) _ a > >
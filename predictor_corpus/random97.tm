@@ -0,0 +1,25 @@
+num-tapes: 2
+input-alphabet: a b
+(start) a _ (accept) a a > >
+(start) a x (reject) x x > >
+(start) b a (q1) x b < -
+(start) b b (start) a a > -
+(start) b _ (reject) a b - <
+(start) b x (start) a b > <
+(start) _ a (q1) a a > >
+(start) _ _ (start) b x < -
+(start) _ x (q1) _ a > <
+(start) x a (start) b x < >
+(start) x b (start) b _ > >
+(start) x _ (q1) x b - -
+(start) x x (start) x b > <
+(q1) a a (start) x _ > <
+(q1) a _ (start) _ a > <
+(q1) a x (q1) b a - <
+(q1) b a (start) b _ - >
+(q1) b b (q1) a x - >
+(q1) b x (q1) x _ > >
+(q1) _ a (q1) _ b > >
+(q1) _ _ (start) b b > >
+(q1) _ x (start) _ x < >
+(q1) x b (start) x _ > >
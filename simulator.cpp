@@ -0,0 +1,780 @@
+#include "simulator.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+#include "errors.h"
+
+using namespace std;
+
+volatile sig_atomic_t stop_requested = 0;
+
+// the signal flag and the clock are checked once per this many steps
+static const uint64_t CHECK_INTERVAL = 1 << 16;
+// above this many keys transitions are kept in a hash map
+static const uint64_t MAX_DENSE_KEYS = 1 << 24;
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+
+// the hash is updated with the data
+static void fnv1a(uint64_t &hash, string_view data) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+}
+
+static uint32_t index_of(const vector<string> &sorted, const string &value) {
+    auto it = lower_bound(sorted.begin(), sorted.end(), value);
+    if (it == sorted.end() || *it != value) return CompiledMachine::NONE;
+    return it - sorted.begin();
+}
+
+void CompiledMachine::prepare() {
+    initial = index_of(states, INITIAL_STATE);
+    accepting = index_of(states, ACCEPTING_STATE);
+    rejecting = index_of(states, REJECTING_STATE);
+    blank = index_of(letters, BLANK);
+
+    // the transitions follow in add()
+    fingerprint = FNV_OFFSET;
+    fnv1a(fingerprint, NUM_TAPES " " + std::to_string(num_tapes) +
+                           "\n" INPUT_ALPHABET);
+    for (const auto &letter : input_alphabet) {
+        fnv1a(fingerprint, " ");
+        fnv1a(fingerprint, letter);
+    }
+    fnv1a(fingerprint, "\n");
+
+    // the keys are numbers in base |letters| prefixed with the state
+    uint64_t keys = states.size();
+    for (int a = 0; a < num_tapes; ++a) {
+        if (keys > UINT64_MAX / letters.size())
+            fatal("Too many tapes to compile the machine");
+        keys *= letters.size();
+    }
+    if (keys <= MAX_DENSE_KEYS) dense.assign(keys, NONE);
+}
+
+void CompiledMachine::add(uint32_t state, const uint32_t *under,
+                          uint32_t state_after, const uint32_t *letters_after,
+                          const int8_t *directions) {
+    uint64_t k = key(state, under);
+    uint32_t number = next_state.size();
+    if (dense.empty())
+        sparse[k] = number;
+    else
+        dense[k] = number;
+
+    next_state.push_back(state_after);
+    for (int a = 0; a < num_tapes; ++a) {
+        next_letters.push_back(letters_after[a]);
+        moves.push_back(directions[a]);
+    }
+
+    // the line of the transition in the machine file
+    fnv1a(fingerprint, states[state]);
+    for (int a = 0; a < num_tapes; ++a) {
+        fnv1a(fingerprint, " ");
+        fnv1a(fingerprint, letters[under[a]]);
+    }
+    fnv1a(fingerprint, " ");
+    fnv1a(fingerprint, states[state_after]);
+    for (int a = 0; a < num_tapes; ++a) {
+        fnv1a(fingerprint, " ");
+        fnv1a(fingerprint, letters[letters_after[a]]);
+    }
+    for (int a = 0; a < num_tapes; ++a) {
+        const char token[] = {' ', directions[a] < 0   ? HEAD_LEFT
+                                   : directions[a] > 0 ? HEAD_RIGHT
+                                                       : HEAD_STAY};
+        fnv1a(fingerprint, string_view(token, sizeof token));
+    }
+    fnv1a(fingerprint, "\n");
+}
+
+CompiledMachine::CompiledMachine(const TuringMachine &tm)
+    : num_tapes(tm.num_tapes),
+      input_alphabet(tm.input_alphabet),
+      states(tm.set_of_states()),
+      letters(tm.working_alphabet()) {
+    prepare();
+    vector<uint32_t> under(num_tapes), letters_after(num_tapes);
+    vector<int8_t> directions(num_tapes);
+    for (const auto &[from, to] : tm.transitions) {
+        for (int a = 0; a < num_tapes; ++a) {
+            under[a] = index_of(letters, from.second[a]);
+            letters_after[a] = index_of(letters, get<1>(to)[a]);
+            directions[a] = get<2>(to)[a] == HEAD_LEFT    ? -1
+                            : get<2>(to)[a] == HEAD_RIGHT ? 1
+                                                          : 0;
+        }
+        add(index_of(states, from.first), under.data(),
+            index_of(states, get<0>(to)), letters_after.data(),
+            directions.data());
+    }
+}
+
+template <int N>
+CompiledMachine::CompiledMachine(const CompactMachine<N> &tm)
+    : num_tapes(N),
+      input_alphabet(tm.input_alphabet),
+      states(tm.states),
+      letters(tm.letters) {
+    prepare();
+    array<int8_t, N> directions;
+    for (const auto &transition : tm.transitions) {
+        for (int a = 0; a < N; ++a) directions[a] = transition.move(a);
+        add(transition.state, transition.letters.data(),
+            transition.next_state, transition.next_letters.data(),
+            directions.data());
+    }
+}
+
+template CompiledMachine::CompiledMachine(const CompactMachine<1> &tm);
+template CompiledMachine::CompiledMachine(const CompactMachine<2> &tm);
+
+template <int N>
+uint64_t CompiledMachine::key(uint32_t state, const uint32_t *under) const {
+    uint64_t k = state;
+    for (int a = 0; a < (N > 0 ? N : num_tapes); ++a)
+        k = k * letters.size() + under[a];
+    return k;
+}
+
+template <int N>
+uint32_t CompiledMachine::find(uint32_t state, const uint32_t *under) const {
+    uint64_t k = key<N>(state, under);
+    if (!dense.empty()) return dense[k];
+    auto it = sparse.find(k);
+    return it == sparse.end() ? NONE : it->second;
+}
+
+uint32_t CompiledMachine::letter_id(const string &letter) const {
+    return index_of(letters, letter);
+}
+
+vector<string> CompiledMachine::parse_input(const string &input) const {
+    return parse_word(input_alphabet, input);
+}
+
+namespace {
+// hands out the pages of all the tapes, once the pages in memory reach the
+// limit the next ones are carved from arenas mapped from a scratch file
+class PageStorage {
+   public:
+    uint64_t ram_limit = UINT64_MAX;
+    string scratch_dir;
+
+    uint32_t *allocate() {
+        lock_guard<mutex> guard(lock);
+        if (ram_pages * PAGE_BYTES < ram_limit) {
+            ++ram_pages;
+            return new uint32_t[Tape::PAGE_SIZE];
+        }
+        if (!free_mapped.empty()) {
+            uint32_t *page = free_mapped.back();
+            free_mapped.pop_back();
+            return page;
+        }
+        if (arena_next == arena_end) map_arena();
+        uint32_t *page = arena_next;
+        arena_next += Tape::PAGE_SIZE;
+        return page;
+    }
+
+    void release(uint32_t *page) {
+        lock_guard<mutex> guard(lock);
+        auto it = arenas.upper_bound(page);
+        if (it != arenas.begin() && page < (--it)->second) {
+            free_mapped.push_back(page);
+        } else {
+            --ram_pages;
+            delete[] page;
+        }
+    }
+
+   private:
+    static const uint64_t PAGE_BYTES = Tape::PAGE_SIZE * sizeof(uint32_t);
+    static const uint64_t ARENA_PAGES = 4096;
+
+    mutex lock;
+    uint64_t ram_pages = 0;
+    int fd = -1;
+    uint64_t file_size = 0;
+    // start -> end of every mapped arena
+    map<uint32_t *, uint32_t *> arenas;
+    uint32_t *arena_next = nullptr, *arena_end = nullptr;
+    vector<uint32_t *> free_mapped;
+
+    void map_arena() {
+        if (fd < 0) {
+            string dir = scratch_dir.empty() ? "/tmp" : scratch_dir;
+            string path = dir + "/tm_tape_XXXXXX";
+            fd = mkstemp(path.data());
+            if (fd < 0) fatal("Cannot create a scratch file in " + dir);
+            unlink(path.c_str());
+        }
+        uint64_t bytes = ARENA_PAGES * PAGE_BYTES;
+        if (ftruncate(fd, file_size + bytes) != 0)
+            fatal("Cannot grow the scratch file");
+        void *mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, file_size);
+        if (mapped == MAP_FAILED) fatal("Cannot map the scratch file");
+        file_size += bytes;
+        arena_next = static_cast<uint32_t *>(mapped);
+        arena_end = arena_next + ARENA_PAGES * Tape::PAGE_SIZE;
+        arenas[arena_next] = arena_end;
+    }
+} storage;
+}  // namespace
+
+void set_page_storage(uint64_t ram_limit, const string &scratch_dir) {
+    storage.ram_limit = ram_limit;
+    storage.scratch_dir = scratch_dir;
+}
+
+Tape::Tape(Tape &&other) noexcept
+    : length(other.length), blank(other.blank), pages(std::move(other.pages)) {
+    other.pages.clear();
+}
+
+Tape &Tape::operator=(Tape &&other) noexcept {
+    if (this != &other) {
+        clear(other.blank);
+        length = other.length;
+        pages = std::move(other.pages);
+        other.pages.clear();
+    }
+    return *this;
+}
+
+Tape::~Tape() { clear(blank); }
+
+uint32_t Tape::get(uint64_t pos) const {
+    const uint32_t *data = page(pos >> PAGE_BITS);
+    return data ? data[pos & (PAGE_SIZE - 1)] : blank;
+}
+
+uint32_t *Tape::cell(uint64_t pos) {
+    uint64_t index = pos >> PAGE_BITS;
+    if (index >= pages.size()) pages.resize(index + 1, nullptr);
+    if (!pages[index]) {
+        pages[index] = storage.allocate();
+        fill(pages[index], pages[index] + PAGE_SIZE, blank);
+    }
+    return pages[index] + (pos & (PAGE_SIZE - 1));
+}
+
+void Tape::clear(uint32_t blank_) {
+    for (uint32_t *data : pages)
+        if (data) storage.release(data);
+    pages.clear();
+    blank = blank_;
+    length = 1;
+}
+
+// pages kept by a reset tape, the pages of a long run beyond them are released
+// so that the runs after it neither refill nor hold them
+static const uint64_t KEPT_PAGES = 16;
+
+void Tape::reset(uint32_t blank_) {
+    if (blank_ != blank) {
+        clear(blank_);
+        return;
+    }
+    // the pages beyond the length were not written since they were filled
+    uint64_t used = min<uint64_t>((length + PAGE_SIZE - 1) >> PAGE_BITS,
+                                  min<uint64_t>(pages.size(), KEPT_PAGES));
+    for (uint64_t index = 0; index < used; ++index)
+        if (pages[index])
+            fill(pages[index], pages[index] + PAGE_SIZE, blank);
+    for (uint64_t index = KEPT_PAGES; index < pages.size(); ++index)
+        if (pages[index]) storage.release(pages[index]);
+    if (pages.size() > KEPT_PAGES) pages.resize(KEPT_PAGES);
+    length = 1;
+}
+
+Configuration::Configuration(const CompiledMachine &machine,
+                             const vector<string> &input) {
+    reset(machine, input);
+}
+
+void Configuration::reset(const CompiledMachine &machine,
+                          const vector<string> &input) {
+    state = machine.initial;
+    steps = 0;
+    tapes.resize(machine.num_tapes);
+    heads.assign(machine.num_tapes, 0);
+    for (auto &tape : tapes) tape.reset(machine.blank);
+    for (size_t i = 0; i < input.size(); ++i) {
+        *tapes[0].cell(i) = machine.letter_id(input[i]);
+        assert(tapes[0].get(i) != CompiledMachine::NONE);
+    }
+    tapes[0].length = max<uint64_t>(1, input.size());
+}
+
+string to_string(Verdict verdict) {
+    switch (verdict) {
+        case Verdict::accept:
+            return "accept";
+        case Verdict::reject:
+            return "reject";
+        case Verdict::fell:
+            return "fell";
+        case Verdict::loops:
+            return "loops";
+        default:
+            return "interrupted";
+    }
+}
+
+string result_line(Verdict verdict, const Configuration &conf,
+                   const LoopDetector &loops) {
+    string line = to_string(verdict) + " " + std::to_string(conf.steps);
+    if (verdict == Verdict::loops) line += " " + std::to_string(loops.cycle);
+    return line;
+}
+
+static uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+namespace {
+// the hash of a cell mixes its position with a random key of its letter, blank
+// cells hash to 0 so that the length of the tapes does not matter
+class CellHash {
+   public:
+    explicit CellHash(const CompiledMachine &machine)
+        : blank(machine.blank), num_tapes(machine.num_tapes) {
+        for (size_t letter = 0; letter < machine.letters.size(); ++letter)
+            keys.push_back(mix(letter + 1));
+        keys[blank] = 0;
+    }
+
+    // change of the hash after writing over the cell
+    uint64_t delta(int tape, uint64_t pos, uint32_t before,
+                   uint32_t after) const {
+        uint64_t position = (pos * num_tapes + tape) * 0x9E3779B97F4A7C15ULL;
+        return cell(position, after) - cell(position, before);
+    }
+
+   private:
+    vector<uint64_t> keys;
+    uint32_t blank;
+    uint64_t num_tapes;
+
+    uint64_t cell(uint64_t position, uint32_t letter) const {
+        if (letter == blank) return 0;
+        uint64_t x = position ^ keys[letter];
+        x = (x ^ (x >> 32)) * 0xD6E8FEB86659FD93ULL;
+        return x ^ (x >> 32);
+    }
+};
+}  // namespace
+
+// the tapes are copied O(log steps) times, as the checkpoint is moved after
+// every power of two steps
+static void checkpoint(LoopDetector &loops, const Configuration &conf,
+                       uint32_t blank) {
+    loops.state = conf.state;
+    loops.heads = conf.heads;
+    loops.hash = loops.tape_hash;
+    loops.steps = conf.steps;
+    loops.tapes.resize(conf.tapes.size());
+    for (size_t a = 0; a < conf.tapes.size(); ++a) {
+        const Tape &tape = conf.tapes[a];
+        auto &cells = loops.tapes[a];
+        cells.resize(tape.length);
+        for (uint64_t pos = 0; pos < tape.length; pos += Tape::PAGE_SIZE) {
+            const uint32_t *data = tape.page(pos >> Tape::PAGE_BITS);
+            size_t count = min(Tape::PAGE_SIZE, tape.length - pos);
+            if (data)
+                copy(data, data + count, cells.begin() + pos);
+            else
+                fill(cells.begin() + pos, cells.begin() + pos + count, blank);
+        }
+    }
+}
+
+// cells beyond the length of a tape or of its copy are blank
+static bool same_tapes(const LoopDetector &loops, const Configuration &conf,
+                       uint32_t blank) {
+    for (size_t a = 0; a < conf.tapes.size(); ++a) {
+        const Tape &tape = conf.tapes[a];
+        const auto &cells = loops.tapes[a];
+        for (uint64_t pos = 0; pos < max<uint64_t>(tape.length, cells.size());
+             ++pos)
+            if (tape.get(pos) != (pos < cells.size() ? cells[pos] : blank))
+                return false;
+    }
+    return true;
+}
+
+// N > 0 is the number of tapes fixed at compile time, so that the loops over
+// the tapes are unrolled and the letters under the heads are kept in arrays on
+// the stack; N = 0 works for any machine
+template <int N, bool detect>
+static Verdict simulate(const CompiledMachine &machine, Configuration &conf,
+                        const Budget &budget, LoopDetector *loops,
+                        const CellHash *hash) {
+    const int num_tapes = N > 0 ? N : machine.num_tapes;
+    conditional_t<N == 0, vector<uint32_t>, array<uint32_t, N>> under;
+    // cells under the heads, within a page the heads move like on a flat array
+    conditional_t<N == 0, vector<uint32_t *>, array<uint32_t *, N>> cursors;
+    if constexpr (N == 0) {
+        under.resize(num_tapes);
+        cursors.resize(num_tapes);
+    }
+    for (int a = 0; a < num_tapes; ++a)
+        cursors[a] = conf.tapes[a].cell(conf.heads[a]);
+
+    while (conf.steps < budget.step_limit) {
+        uint64_t chunk_end =
+            min(budget.step_limit, conf.steps + CHECK_INTERVAL);
+        while (conf.steps < chunk_end) {
+            if (conf.state == machine.accepting) return Verdict::accept;
+            if (conf.state == machine.rejecting) return Verdict::reject;
+
+            for (int a = 0; a < num_tapes; ++a) under[a] = *cursors[a];
+            uint32_t transition = machine.find<N>(conf.state, under.data());
+            // no transition means rejection
+            if (transition == CompiledMachine::NONE) return Verdict::reject;
+
+            ++conf.steps;
+            conf.state = machine.next_state[transition];
+            // entering the rejecting state rejects regardless of the moves,
+            // the same way as in the two to one conversion
+            if (conf.state == machine.rejecting) return Verdict::reject;
+
+            for (int a = 0; a < num_tapes; ++a) {
+                auto &tape = conf.tapes[a];
+                auto &head = conf.heads[a];
+                auto &cursor = cursors[a];
+                size_t i = (size_t)transition * num_tapes + a;
+                if constexpr (detect) {
+                    if (*cursor != machine.next_letters[i])
+                        loops->tape_hash += hash->delta(
+                            a, head, *cursor, machine.next_letters[i]);
+                }
+                *cursor = machine.next_letters[i];
+                if (machine.moves[i] < 0) {
+                    if (head == 0) return Verdict::fell;
+                    if ((head-- & (Tape::PAGE_SIZE - 1)) == 0)
+                        cursor = tape.cell(head);
+                    else
+                        --cursor;
+                } else if (machine.moves[i] > 0) {
+                    if ((++head & (Tape::PAGE_SIZE - 1)) == 0)
+                        cursor = tape.cell(head);
+                    else
+                        ++cursor;
+                    if (head == tape.length) ++tape.length;
+                }
+            }
+
+            if constexpr (detect) {
+                // a collision of the hashes is ruled out by comparing the
+                // tapes themselves
+                if (conf.state == loops->state &&
+                    loops->tape_hash == loops->hash &&
+                    conf.heads == loops->heads &&
+                    same_tapes(*loops, conf, machine.blank)) {
+                    loops->cycle = conf.steps - loops->steps;
+                    return Verdict::loops;
+                }
+                // the checkpoint is moved once the cycle could not be longer
+                // than the distance to it
+                if (conf.steps - loops->steps == loops->power) {
+                    checkpoint(*loops, conf, machine.blank);
+                    loops->power *= 2;
+                }
+            }
+        }
+        if (stop_requested || chrono::steady_clock::now() >= budget.deadline)
+            return Verdict::interrupted;
+    }
+    if (conf.state == machine.accepting) return Verdict::accept;
+    if (conf.state == machine.rejecting) return Verdict::reject;
+    return Verdict::interrupted;
+}
+
+// machines with one or two tapes, as read and written by the converter, get
+// their own instances of the simulation
+template <bool detect>
+static Verdict dispatch(const CompiledMachine &machine, Configuration &conf,
+                        const Budget &budget, LoopDetector *loops,
+                        const CellHash *hash) {
+    switch (machine.num_tapes) {
+        case 1:
+            return simulate<1, detect>(machine, conf, budget, loops, hash);
+        case 2:
+            return simulate<2, detect>(machine, conf, budget, loops, hash);
+        default:
+            return simulate<0, detect>(machine, conf, budget, loops, hash);
+    }
+}
+
+Verdict run(const CompiledMachine &machine, Configuration &conf,
+            const Budget &budget, LoopDetector *loops) {
+    if (!loops)
+        return dispatch<false>(machine, conf, budget, nullptr, nullptr);
+
+    // the hash of the tapes is computed once, then kept up to date
+    const CellHash hash(machine);
+    if (!loops->hashed) {
+        loops->tape_hash = 0;
+        for (size_t a = 0; a < conf.tapes.size(); ++a) {
+            const Tape &tape = conf.tapes[a];
+            for (uint64_t pos = 0; pos < tape.length; ++pos)
+                loops->tape_hash +=
+                    hash.delta(a, pos, machine.blank, tape.get(pos));
+        }
+        loops->hashed = true;
+        checkpoint(*loops, conf, machine.blank);
+        loops->power = 1;
+    }
+    return dispatch<true>(machine, conf, budget, loops, &hash);
+}
+
+namespace {
+// words waiting for a worker, the owner takes them from the front and idle
+// workers steal from the back
+struct WorkQueue {
+    mutex lock;
+    deque<size_t> words;
+};
+
+// results are published here and written out in the order of the words
+struct Results {
+    mutex lock;
+    condition_variable published;
+    vector<string> lines;
+    vector<bool> ready;
+    // workers that took their last word
+    size_t finished = 0;
+};
+
+bool take_work(vector<WorkQueue> &queues, size_t self, size_t &word) {
+    {
+        lock_guard<mutex> guard(queues[self].lock);
+        if (!queues[self].words.empty()) {
+            word = queues[self].words.front();
+            queues[self].words.pop_front();
+            return true;
+        }
+    }
+    // steal half of the victim's remaining words, so that a worker stuck on
+    // a long run gives away everything it would not get to soon
+    for (size_t i = 1; i < queues.size(); ++i) {
+        auto &victim = queues[(self + i) % queues.size()];
+        deque<size_t> stolen;
+        {
+            lock_guard<mutex> guard(victim.lock);
+            size_t count = (victim.words.size() + 1) / 2;
+            for (; count > 0; --count) {
+                stolen.push_front(victim.words.back());
+                victim.words.pop_back();
+            }
+        }
+        if (stolen.empty()) continue;
+        word = stolen.front();
+        stolen.pop_front();
+        lock_guard<mutex> guard(queues[self].lock);
+        queues[self].words.insert(queues[self].words.end(), stolen.begin(),
+                                  stolen.end());
+        return true;
+    }
+    return false;
+}
+}  // namespace
+
+void run_all(const CompiledMachine &machine, const vector<string> &words,
+             unsigned threads, uint64_t max_steps,
+             chrono::steady_clock::duration max_time, bool detect_loops,
+             ostream &output) {
+    threads = max(1u, min<unsigned>(threads, words.size()));
+    vector<WorkQueue> queues(threads);
+    // contiguous blocks, so that the output can usually be written while the
+    // first worker is still running
+    for (size_t i = 0; i < words.size(); ++i)
+        queues[i * threads / words.size()].words.push_back(i);
+
+    Results results;
+    results.lines.resize(words.size());
+    results.ready.resize(words.size());
+
+    auto worker = [&](size_t self) {
+        // the tapes are reused between the words of a worker
+        Configuration conf;
+        size_t word;
+        // once a stop is requested no more words are started
+        while (!stop_requested && take_work(queues, self, word)) {
+            vector<string> input = machine.parse_input(words[word]);
+            assert(words[word].empty() || !input.empty());
+            conf.reset(machine, input);
+            Budget budget;
+            budget.step_limit = max_steps;
+            auto now = chrono::steady_clock::now();
+            if (max_time < budget.deadline - now)
+                budget.deadline = now + max_time;
+            LoopDetector loops;
+            Verdict verdict =
+                run(machine, conf, budget, detect_loops ? &loops : nullptr);
+            string line = result_line(verdict, conf, loops);
+            lock_guard<mutex> guard(results.lock);
+            results.lines[word] = std::move(line);
+            results.ready[word] = true;
+            results.published.notify_one();
+        }
+        lock_guard<mutex> guard(results.lock);
+        ++results.finished;
+        results.published.notify_one();
+    };
+    vector<thread> pool;
+    for (size_t i = 0; i < threads; ++i) pool.emplace_back(worker, i);
+
+    for (size_t i = 0; i < words.size(); ++i) {
+        unique_lock<mutex> guard(results.lock);
+        results.published.wait(guard, [&] {
+            return results.ready[i] || results.finished == threads;
+        });
+        // the output ends at the first word left out after a stop
+        if (!results.ready[i]) break;
+        string line = std::move(results.lines[i]);
+        guard.unlock();
+        output << line << "\n";
+    }
+    output.flush();
+    for (auto &t : pool) t.join();
+}
+
+// snapshot layout, every field in the host's byte order:
+//   SnapshotHeader
+//   num_tapes x { uint64_t head, uint64_t length }
+//   num_tapes x length x uint32_t letters
+// every section is aligned, so the file can be mapped and read in place
+namespace {
+const char SNAPSHOT_MAGIC[8] = "TMSNAP1";
+
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t fingerprint;
+    uint64_t steps;
+    uint32_t state;
+    uint32_t num_tapes;
+};
+}  // namespace
+
+void save_snapshot(const CompiledMachine &machine, const Configuration &conf,
+                   const string &path) {
+    string tmp_path = path + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if (!f) fatal("Cannot write snapshot " + tmp_path);
+
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.fingerprint = machine.fingerprint;
+    header.steps = conf.steps;
+    header.state = conf.state;
+    header.num_tapes = conf.tapes.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (size_t a = 0; a < conf.tapes.size(); ++a) {
+        uint64_t extent[2] = {conf.heads[a], conf.tapes[a].length};
+        ok = ok && fwrite(extent, sizeof(extent), 1, f) == 1;
+    }
+    // pages never written are stored as blanks
+    vector<uint32_t> blanks(Tape::PAGE_SIZE, machine.blank);
+    for (const auto &tape : conf.tapes) {
+        for (uint64_t pos = 0; ok && pos < tape.length;
+             pos += Tape::PAGE_SIZE) {
+            const uint32_t *data = tape.page(pos >> Tape::PAGE_BITS);
+            size_t count = min(Tape::PAGE_SIZE, tape.length - pos);
+            ok = fwrite(data ? data : blanks.data(), sizeof(uint32_t), count,
+                        f) == count;
+        }
+    }
+    ok = fflush(f) == 0 && ok && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0)
+        fatal("Cannot write snapshot " + path);
+}
+
+Configuration load_snapshot(const CompiledMachine &machine,
+                            const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) fatal("Snapshot " + path + " does not exist");
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader))
+        fatal("Snapshot " + path + " is corrupted");
+    size_t size = st.st_size;
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) fatal("Cannot map snapshot " + path);
+
+    const char *data = static_cast<const char *>(mapped);
+    const auto *header = reinterpret_cast<const SnapshotHeader *>(data);
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0)
+        fatal("Snapshot " + path + " is corrupted");
+    // the number of tapes and states differ for most other machines
+    if (header->fingerprint != machine.fingerprint)
+        fatal("Snapshot " + path + " was taken for a different machine");
+    if (header->num_tapes != (uint32_t)machine.num_tapes ||
+        header->state >= machine.states.size())
+        fatal("Snapshot " + path + " is corrupted");
+
+    Configuration conf;
+    conf.state = header->state;
+    conf.steps = header->steps;
+    const auto *extents =
+        reinterpret_cast<const uint64_t *>(data + sizeof(SnapshotHeader));
+    size_t offset = sizeof(SnapshotHeader) + 2 * sizeof(uint64_t) *
+                                                 header->num_tapes;
+    // the extents are read before the sizes of the tapes can be checked
+    if (offset > size) fatal("Snapshot " + path + " is corrupted");
+    for (uint32_t a = 0; a < header->num_tapes; ++a) {
+        uint64_t head = extents[2 * a], length = extents[2 * a + 1];
+        if (length == 0 || head >= length ||
+            length > (size - offset) / sizeof(uint32_t))
+            fatal("Snapshot " + path + " is corrupted");
+        const auto *cells = reinterpret_cast<const uint32_t *>(data + offset);
+        Tape &tape = conf.tapes.emplace_back(machine.blank);
+        // blank pages are left unallocated
+        for (uint64_t pos = 0; pos < length; pos += Tape::PAGE_SIZE) {
+            size_t count = min(Tape::PAGE_SIZE, length - pos);
+            const uint32_t *from = cells + pos;
+            if (any_of(from, from + count, [&](uint32_t letter) {
+                    return letter != machine.blank;
+                }))
+                copy(from, from + count, tape.cell(pos));
+        }
+        for (uint64_t pos = 0; pos < length; ++pos)
+            if (cells[pos] >= machine.letters.size())
+                fatal("Snapshot " + path + " is corrupted");
+        tape.length = length;
+        conf.heads.push_back(head);
+        offset += length * sizeof(uint32_t);
+    }
+    munmap(mapped, size);
+    return conf;
+}
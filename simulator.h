@@ -0,0 +1,186 @@
+#ifndef __SIMULATOR_H
+#define __SIMULATOR_H
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "turing_machine.h"
+
+// a machine with states and letters replaced by consecutive numbers, so that a
+// single step is a table lookup instead of a search in transitions_t
+struct CompiledMachine {
+    static const uint32_t NONE = UINT32_MAX;
+
+    int num_tapes;
+    std::vector<std::string> input_alphabet;
+    std::vector<std::string> states;   // number -> identifier
+    std::vector<std::string> letters;  // number -> identifier
+    uint32_t initial, accepting, rejecting, blank;
+    // identifies the machine in snapshots, the hash of the machine as written
+    // by TuringMachine::save_to_file
+    uint64_t fingerprint;
+
+    // for every transition: new state, new letters and moves (-1, 0 or 1)
+    std::vector<uint32_t> next_state;
+    std::vector<uint32_t> next_letters;
+    std::vector<int8_t> moves;
+
+    explicit CompiledMachine(const TuringMachine &tm);
+    // the same machine as from the TuringMachine with these transitions
+    template <int N>
+    explicit CompiledMachine(const CompactMachine<N> &tm);
+
+    // number of the transition from the state with the letters under the heads
+    // or NONE if there is no such transition; N > 0 fixes the number of tapes
+    // at compile time
+    template <int N = 0>
+    uint32_t find(uint32_t state, const uint32_t *under) const;
+
+    // NONE if the letter is not in the working alphabet
+    uint32_t letter_id(const std::string &letter) const;
+
+    // see TuringMachine::parse_input
+    std::vector<std::string> parse_input(const std::string &input) const;
+
+   private:
+    // the key space is small enough for a direct table
+    std::vector<uint32_t> dense;
+    std::unordered_map<uint64_t, uint32_t> sparse;
+
+    template <int N = 0>
+    uint64_t key(uint32_t state, const uint32_t *under) const;
+
+    // once the states and letters are known
+    void prepare();
+    // the transition gets the next number, the transitions are added in the
+    // order of transitions_t
+    void add(uint32_t state, const uint32_t *under, uint32_t state_after,
+             const uint32_t *letters_after, const int8_t *directions);
+};
+
+// pages above the limit are mapped from an unlinked scratch file created in
+// the directory, by default pages are never backed by a file
+void set_page_storage(uint64_t ram_limit, const std::string &scratch_dir);
+
+// tape split into pages allocated on the first write, the cells of pages that
+// were never written are blank
+class Tape {
+   public:
+    static const int PAGE_BITS = 12;
+    static const uint64_t PAGE_SIZE = 1 << PAGE_BITS;
+
+    // one after the rightmost cell the head has been on
+    uint64_t length = 1;
+
+    explicit Tape(uint32_t blank_ = 0) : blank(blank_) {}
+    Tape(Tape &&other) noexcept;
+    Tape &operator=(Tape &&other) noexcept;
+    ~Tape();
+
+    uint32_t get(uint64_t pos) const;
+    // the cell's page is allocated if needed, the pointer stays valid for the
+    // whole page until the tape is cleared
+    uint32_t *cell(uint64_t pos);
+
+    // nullptr if no cell of the page was written
+    const uint32_t *page(uint64_t index) const {
+        return index < pages.size() ? pages[index] : nullptr;
+    }
+
+    // releases all the pages
+    void clear(uint32_t blank_);
+
+    // keeps the first pages filled with the blank, so that a reused tape does
+    // not allocate them again; only the pages up to length are refilled, so
+    // every write must stay below it
+    void reset(uint32_t blank_);
+
+   private:
+    uint32_t blank;
+    std::vector<uint32_t *> pages;
+};
+
+struct Configuration {
+    uint32_t state;
+    uint64_t steps = 0;
+    std::vector<Tape> tapes;
+    std::vector<uint64_t> heads;
+
+    Configuration() = default;
+    // initial configuration with the input on the first tape
+    Configuration(const CompiledMachine &machine,
+                  const std::vector<std::string> &input);
+
+    // same as a new initial configuration, but reuses the tapes and their
+    // pages
+    void reset(const CompiledMachine &machine,
+               const std::vector<std::string> &input);
+};
+
+enum class Verdict { accept, reject, fell, loops, interrupted };
+
+std::string to_string(Verdict verdict);
+
+struct Budget {
+    // absolute, compared against Configuration::steps
+    uint64_t step_limit = UINT64_MAX;
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point::max();
+};
+
+// Brent's cycle detection, the configuration is compared with a checkpoint
+// that is moved after every power of two steps; states and heads are compared
+// exactly and the tapes by a hash updated on every write, only when the hashes
+// match the tapes are compared with the copy taken at the checkpoint
+struct LoopDetector {
+    // length of the cycle once the verdict is loops
+    uint64_t cycle = 0;
+
+    // sum of the hashes of the non-blank cells of all the tapes
+    uint64_t tape_hash = 0;
+    // false until tape_hash is computed for the configuration
+    bool hashed = false;
+
+    uint32_t state;
+    std::vector<uint64_t> heads;
+    uint64_t hash, steps, power;
+    // cells of every tape up to its length
+    std::vector<std::vector<uint32_t>> tapes;
+};
+
+// set by signal handlers to the signal number, the simulation is interrupted
+// at the next check
+extern volatile std::sig_atomic_t stop_requested;
+
+// runs until the machine halts or the budget is exhausted, with a detector
+// also until a configuration repeats, the detector must not be shared between
+// configurations
+Verdict run(const CompiledMachine &machine, Configuration &conf,
+            const Budget &budget, LoopDetector *loops = nullptr);
+
+// "<verdict> <steps>", followed by the cycle length for loops
+std::string result_line(Verdict verdict, const Configuration &conf,
+                        const LoopDetector &loops);
+
+// runs the machine on every word using a pool of threads, each word gets its
+// own step and time budget; result lines are written in the order of the words
+// as soon as they are known; every word must be over the input alphabet
+void run_all(const CompiledMachine &machine,
+             const std::vector<std::string> &words, unsigned threads,
+             uint64_t max_steps, std::chrono::steady_clock::duration max_time,
+             bool detect_loops, std::ostream &output);
+
+// the snapshot is written to a temporary file and renamed, so a crash never
+// leaves a broken snapshot behind
+void save_snapshot(const CompiledMachine &machine, const Configuration &conf,
+                   const std::string &path);
+
+Configuration load_snapshot(const CompiledMachine &machine,
+                            const std::string &path);
+
+#endif
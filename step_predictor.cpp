@@ -0,0 +1,105 @@
+#include "step_predictor.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+// the costs below follow the generators in turing_machine.cpp, a change of
+// the default protocol has to be reflected here
+
+// preparation of the tape up to reading the first letter in (ftchF start):
+// copying the input one cell right, reversing it, spreading it over every
+// other cell and appending the separator and the second tape
+static uint64_t preparation_steps(uint64_t n) {
+    if (n == 0) return 13;
+    return 3 * n * n + 7 * n + 12;
+}
+
+Prediction predict_converted(const CompiledMachine &machine,
+                             const vector<string> &input,
+                             uint64_t max_source_steps) {
+    assert(machine.num_tapes == 2);
+    Configuration conf(machine, input);
+    Tape &first = conf.tapes[0], &second = conf.tapes[1];
+    uint64_t &h1 = conf.heads[0], &h2 = conf.heads[1];
+    // cells of the virtual tapes, the empty input still gets one blank cell
+    uint64_t length1 = max<uint64_t>(input.size(), 1), length2 = 1;
+
+    Prediction result;
+    result.steps = preparation_steps(input.size());
+    // after a left shift the step starts at the second head with the blank
+    // under the first one already known
+    bool shifted = false;
+    auto halt = [&](Verdict verdict) {
+        result.verdict = verdict;
+        result.source_steps = conf.steps;
+        return result;
+    };
+
+    for (;;) {
+        if (conf.steps == max_source_steps) return halt(Verdict::interrupted);
+
+        const uint32_t under[2] = {first.get(h1), second.get(h2)};
+        const uint32_t transition = machine.find<2>(conf.state, under);
+        // fetch the first letter, carry it to the second head and fetch the
+        // second letter
+        result.steps += shifted ? 1 : 5 + 2 * h1 + 2 * h2;
+        shifted = false;
+        if (transition == CompiledMachine::NONE) return halt(Verdict::reject);
+        ++conf.steps;
+        const uint32_t state = machine.next_state[transition];
+        const uint32_t *letters = &machine.next_letters[2 * transition];
+        const int8_t *moves = &machine.moves[2 * transition];
+
+        // the second tape is updated first, even when the source machine
+        // halts: erase the indicator, write the letter and place the indicator
+        result.steps += 3;
+        if (moves[1] < 0) {
+            // there is no transition on the separator
+            if (h2 == 0) return halt(Verdict::reject);
+            result.steps += 2;
+        } else if (moves[1] > 0) {
+            // the right guard is moved one cell further
+            if (h2 + 1 == length2) {
+                result.steps += 4;
+                ++length2;
+            }
+        }
+        *second.cell(h2) = letters[1];
+        h2 += moves[1];
+
+        // search the first head, fetch its letter again and erase the
+        // indicator
+        result.steps += 2 * h1 + 2 * h2 + 4;
+        if (state == machine.accepting) {
+            result.steps += 1;
+            if (moves[0] >= 0 || h1 > 0) {
+                result.steps += moves[0] < 0;
+                return halt(Verdict::accept);
+            }
+            // falls off the left end of the tape from the separator
+            result.steps += 1 + 2 * length1 + 1;
+            return halt(Verdict::fell);
+        }
+        if (state == machine.rejecting) return halt(Verdict::reject);
+
+        // write the letter and place the indicator
+        result.steps += 2;
+        if (moves[0] < 0) {
+            // there is no transition on the separator
+            if (h1 == 0) return halt(Verdict::reject);
+            result.steps += 2;
+        } else if (moves[0] > 0 && h1 + 1 == length1) {
+            // the whole tape right of the left guard is shifted two cells,
+            // then the second head is searched from the right guard
+            result.steps +=
+                2 * (length1 + length2) + 4 + 2 * (length2 - h2);
+            ++length1;
+            shifted = true;
+        }
+        *first.cell(h1) = letters[0];
+        h1 += moves[0];
+        conf.state = state;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef __STEP_PREDICTOR_H
+#define __STEP_PREDICTOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "simulator.h"
+
+// The number of steps of the machine produced by twoToOne() with the default
+// options, computed by simulating only the two tape source machine. Every
+// source step costs a fixed number of steps of the converted machine plus the
+// distance between the heads it walks, which depends only on the head
+// positions and on the lengths of the virtual tapes:
+//
+//   LG a(L1-1) i(L1-1) ... a(0) i(0) Sep i(0) b(0) ... i(L2-1) b(L2-1) RG
+//
+// The first tape is stored reversed left of the separator and the second one
+// right of it, every cell followed (or preceded) by the slot of its head
+// indicator.
+
+struct Prediction {
+    // verdict of the converted machine, interrupted when the source machine
+    // ran out of the step budget
+    Verdict verdict;
+    // steps of the converted machine, up to the end of the last source step
+    // when interrupted
+    uint64_t steps = 0;
+    // steps of the source machine
+    uint64_t source_steps = 0;
+};
+
+// the machine must have two tapes, the input must be in its alphabet
+Prediction predict_converted(const CompiledMachine &machine,
+                             const std::vector<std::string> &input,
+                             uint64_t max_source_steps = UINT64_MAX);
+
+#endif
@@ -1,23 +1,192 @@
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <sstream>
 
+#include "conversion_cache.h"
+#include "errors.h"
+#include "simulator.h"
+#include "transition_runs.h"
 #include "turing_machine.h"
 
 static void print_usage(std::string error) {
     std::cerr << "ERROR: " << error << "\n"
-              << "Usage: tm_interpreter <input_file> <output_file>\n";
+              << "Usage: tm_converter [--fused | --codeword-base <base> |"
+                 " --in-place] <input_file> <output_file>\n"
+              << "Block speedup: [--block <size> [--keep-tapes]"
+                 " [--sample <words_file>]]\n"
+              << "Cache: [--cache-dir <dir>] [--cache-size <MiB>]\n"
+              << "External memory: [--spill-dir <dir> [--spill-memory <MiB>]"
+                 " [--spill-disk <MiB>]]\n"
+              << "Debugging: [--count-writes]\n";
     exit(1);
 }
 
+// budget of every sample word on each of the machines
+static const uint64_t SAMPLE_STEPS = 100000000;
+
+// compares the numbers of transitions, then runs both machines on every word
+// and compares the steps of the words they both halt on within the budget
+static void report_speedup(const TuringMachine &before,
+                           const TuringMachine &after,
+                           const std::string &words_file) {
+    std::ifstream words(words_file);
+    if (!words) fatal("File " + words_file + " does not exist");
+    std::cout << "transitions: " << before.transitions.size() << " -> "
+              << after.transitions.size() << "\n";
+    CompiledMachine slow(before), fast(after);
+    Budget budget;
+    budget.step_limit = SAMPLE_STEPS;
+    uint64_t slow_steps = 0, fast_steps = 0, halted = 0, total = 0;
+    for (std::string word; std::getline(words, word); ++total) {
+        std::vector<std::string> input = before.parse_input(word);
+        if (!word.empty() && input.empty())
+            fatal("Invalid input word " + word);
+        Configuration slow_conf(slow, input), fast_conf(fast, input);
+        Verdict slow_verdict = run(slow, slow_conf, budget);
+        Verdict fast_verdict = run(fast, fast_conf, budget);
+        if (slow_verdict == Verdict::interrupted ||
+            fast_verdict == Verdict::interrupted)
+            continue;
+        if (slow_verdict != fast_verdict)
+            fatal("The block machine gives " + to_string(fast_verdict) +
+                  " instead of " + to_string(slow_verdict) + " on " + word);
+        ++halted;
+        slow_steps += slow_conf.steps;
+        fast_steps += fast_conf.steps;
+    }
+    std::cout << "steps: " << slow_steps << " -> " << fast_steps;
+    if (fast_steps > 0)
+        std::cout << " (" << (double)slow_steps / fast_steps << "x)";
+    std::cout << " on " << halted << " of " << total << " words\n";
+}
+
+// transitions written more than once by the generators of the conversion,
+// without all only the generators that wrote some transition twice
+static void print_write_counts(bool all) {
+    bool header = false;
+    for (const auto &[generator, counts] : write_counts()) {
+        if (counts.writes == 0 ||
+            (!all && counts.redundant == 0 && counts.conflicting == 0))
+            continue;
+        if (!header)
+            std::cerr << "generator writes redundant conflicting\n";
+        header = true;
+        std::cerr << generator << " " << counts.writes << " "
+                  << counts.redundant << " " << counts.conflicting << "\n";
+    }
+}
+
+// an option given in MiB, in bytes
+static uint64_t parse_size(const std::string &option,
+                           const std::string &value) {
+    return std::min<uint64_t>(parse_integer(option, value, print_usage),
+                              UINT64_MAX >> 20)
+           << 20;
+}
+
+// a converted machine being written, removed on exit unless renamed
+static std::string temporary_output;
+
+static void remove_temporary_output() {
+    if (!temporary_output.empty()) unlink(temporary_output.c_str());
+}
+
+// the machine, converted or copied from the cache, is written next to the
+// output file and renamed over it by finish_output, so that a failure on the
+// way, e.g. while merging the runs, leaves the output as it was; anything but a
+// regular file is written in place. Returns the path to write to.
+static std::string start_output(const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && !S_ISREG(st.st_mode)) return path;
+    std::atexit(remove_temporary_output);
+    temporary_output = path + ".tmp.XXXXXX";
+    int fd = mkstemp(temporary_output.data());
+    if (fd < 0) {
+        temporary_output.clear();
+        fatal("Cannot write " + path);
+    }
+    // the permissions a new file would get
+    mode_t mask = umask(0);
+    umask(mask);
+    fchmod(fd, 0666 & ~mask);
+    close(fd);
+    return temporary_output;
+}
+
+static void finish_output(const std::string &path) {
+    if (!temporary_output.empty() &&
+        rename(temporary_output.c_str(), path.c_str()) != 0)
+        fatal("Cannot write " + path);
+    temporary_output.clear();
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 3) print_usage("Bad number of arguments");
+    ConversionOptions options;
+    std::string cache_dir;
+    uint64_t cache_size = 1024 << 20;
+    std::string sample;
+    bool count_writes = false;
+    std::string spill_dir;
+    uint64_t spill_memory = 256 << 20, spill_disk = UINT64_MAX;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--fused") {
+            options.fused = true;
+        } else if (arg == "--codeword-base") {
+            if (++i == argc) print_usage("Missing value of " + arg);
+            options.codewordBase = parse_integer(arg, argv[i], print_usage, 2, 1000);
+        } else if (arg == "--in-place") {
+            options.inPlace = true;
+        } else if (arg == "--keep-tapes") {
+            options.keepTapes = true;
+        } else if (arg == "--count-writes") {
+            count_writes = true;
+        } else if (arg == "--block" || arg == "--sample" ||
+                   arg == "--cache-dir" || arg == "--cache-size" ||
+                   arg == "--spill-dir" || arg == "--spill-memory" ||
+                   arg == "--spill-disk") {
+            if (++i == argc) print_usage("Missing value of " + arg);
+            if (arg == "--block")
+                options.blockSize = parse_integer(arg, argv[i], print_usage, 2, 16);
+            else if (arg == "--sample")
+                sample = argv[i];
+            else if (arg == "--cache-dir")
+                cache_dir = argv[i];
+            else if (arg == "--cache-size")
+                cache_size = parse_size(arg, argv[i]);
+            else if (arg == "--spill-dir")
+                spill_dir = argv[i];
+            else if (arg == "--spill-memory")
+                spill_memory = std::max<uint64_t>(parse_size(arg, argv[i]),
+                                                 1 << 20);
+            else
+                spill_disk = parse_size(arg, argv[i]);
+        } else if (arg.starts_with("--")) {
+            print_usage("Unknown option " + arg);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() != 2) print_usage("Bad number of arguments");
+    if (options.fused + (options.codewordBase > 0) + options.inPlace +
+            options.keepTapes > 1)
+        print_usage("Only one variant of the conversion can be chosen");
+    if ((options.keepTapes || !sample.empty()) && options.blockSize == 0)
+        print_usage("--keep-tapes and --sample need --block");
+    if (!sample.empty() && !spill_dir.empty())
+        print_usage("--sample needs the converted machine in memory");
 
-    std::string filename = argv[1];
-    std::string outFilename = argv[2];
+    std::string filename = args[0];
+    std::string outFilename = args[1];
 
     FILE *f = fopen(filename.c_str(), "r");
     if (!f) {
@@ -26,10 +195,45 @@ int main(int argc, char *argv[]) {
     }
     TuringMachine tm = read_tm_from_file(f);
 
+    // the same machine converted with the same options is copied from the
+    // cache instead, unless the speedup is to be measured
+    std::string written = start_output(outFilename);
+    std::string key;
+    if (!cache_dir.empty()) {
+        open_cache(cache_dir);
+        key = cache_key(tm, options);
+        if (sample.empty() && fetch_from_cache(cache_dir, key, written)) {
+            finish_output(outFilename);
+            return 0;
+        }
+    }
+
+    // the transitions of the last stage go to sorted runs on disk and are
+    // merged straight into the output file
+    std::optional<TransitionRuns> runs;
+    if (!spill_dir.empty()) runs.emplace(spill_dir, spill_memory, spill_disk);
+    TransitionRuns *external = runs ? &*runs : nullptr;
+
     //-----------------CONVERSION-----------------//
-    tm.twoToOne();
+    if (!options.keepTapes)
+        tm.twoToOne(options, options.blockSize > 0 ? nullptr : external);
+    if (options.blockSize > 0) {
+        // the machine before the blocks is only kept to be compared with
+        std::optional<TuringMachine> before;
+        if (!sample.empty()) before = tm;
+        tm.toBlocks(options.blockSize, external);
+        if (before) report_speedup(*before, tm, sample);
+    }
 
-    std::ofstream file(outFilename);
+    std::ofstream file(written);
     file << tm;
     file.close();
+    if (!file) fatal("Cannot write " + outFilename);
+    finish_output(outFilename);
+    // the writes to the runs are only all counted once they are merged into
+    // the output
+    print_write_counts(count_writes);
+
+    if (!cache_dir.empty())
+        store_in_cache(cache_dir, key, outFilename, cache_size);
 }
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "errors.h"
+#include "simulator.h"
+#include "turing_machine.h"
+
+static void print_usage(std::string error) {
+    std::cerr << "ERROR: " << error << "\n"
+              << "Usage: tm_interpreter [--max-steps <n>]"
+                 " [--max-time <seconds>] [--snapshot <file>]"
+                 " [--resume <file>] <machine_file> [<input_word>]\n"
+              << "       tm_interpreter [--max-steps <n>]"
+                 " [--max-time <seconds>] [--threads <n>]"
+                 " --inputs <words_file> <machine_file>\n"
+              << "Tape storage: [--ram-limit <MiB>] [--scratch-dir <dir>]\n"
+              << "Loop detection: [--detect-loops]\n";
+    exit(1);
+}
+
+static void request_stop(int signal) { stop_requested = signal; }
+
+int main(int argc, char *argv[]) {
+    uint64_t max_steps = UINT64_MAX;
+    uint64_t max_seconds = 0;
+    uint64_t threads = std::thread::hardware_concurrency();
+    uint64_t ram_limit = UINT64_MAX;
+    bool detect_loops = false;
+    std::string snapshot, resume, inputs, scratch_dir;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max-steps" || arg == "--max-time" ||
+            arg == "--snapshot" || arg == "--resume" || arg == "--inputs" ||
+            arg == "--threads" || arg == "--ram-limit" ||
+            arg == "--scratch-dir") {
+            if (++i == argc) print_usage("Missing value of " + arg);
+            if (arg == "--max-steps")
+                max_steps = parse_integer(arg, argv[i], print_usage);
+            else if (arg == "--max-time")
+                max_seconds = parse_integer(arg, argv[i], print_usage);
+            else if (arg == "--threads")
+                threads = parse_integer(arg, argv[i], print_usage);
+            else if (arg == "--ram-limit")
+                ram_limit = std::min<uint64_t>(parse_integer(arg, argv[i], print_usage),
+                                          UINT64_MAX >> 20)
+                            << 20;
+            else if (arg == "--scratch-dir")
+                scratch_dir = argv[i];
+            else if (arg == "--snapshot")
+                snapshot = argv[i];
+            else if (arg == "--resume")
+                resume = argv[i];
+            else
+                inputs = argv[i];
+        } else if (arg == "--detect-loops") {
+            detect_loops = true;
+        } else if (arg.starts_with("--")) {
+            print_usage("Unknown option " + arg);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty() || args.size() > (inputs.empty() ? 2 : 1))
+        print_usage("Bad number of arguments");
+    if (!resume.empty() && args.size() == 2)
+        print_usage("The input word is restored from the snapshot");
+    if (!inputs.empty() && (!snapshot.empty() || !resume.empty()))
+        print_usage("Snapshots are not available with --inputs");
+
+    std::string filename = args[0];
+    FILE *f = fopen(filename.c_str(), "r");
+    if (!f) {
+        std::cerr << "ERROR: File " << filename << " does not exist\n";
+        return 1;
+    }
+    // machines with one or two tapes are compiled from their compact form
+    CompiledMachine machine =
+        std::visit([](const auto &tm) { return CompiledMachine(tm); },
+                   read_tm_for_simulation(f));
+    set_page_storage(ram_limit, scratch_dir);
+
+    if (!inputs.empty()) {
+        std::ifstream words_file(inputs);
+        if (!words_file) {
+            std::cerr << "ERROR: File " << inputs << " does not exist\n";
+            return 1;
+        }
+        // one word per line, an empty line is the empty word
+        std::vector<std::string> words;
+        for (std::string word; std::getline(words_file, word);)
+            words.push_back(word);
+        // the whole file is rejected before any word is run
+        for (const auto &word : words) {
+            if (!word.empty() && machine.parse_input(word).empty()) {
+                std::cerr << "ERROR: Invalid input word " << word << "\n";
+                return 1;
+            }
+        }
+
+        std::signal(SIGINT, request_stop);
+        std::signal(SIGTERM, request_stop);
+        run_all(machine, words, threads, max_steps,
+                max_seconds > 0 ? std::chrono::seconds(max_seconds)
+                                : std::chrono::steady_clock::duration::max(),
+                detect_loops, std::cout);
+        return 0;
+    }
+
+    Configuration conf;
+    if (!resume.empty()) {
+        conf = load_snapshot(machine, resume);
+    } else {
+        std::string word = args.size() == 2 ? args[1] : "";
+        std::vector<std::string> input = machine.parse_input(word);
+        if (!word.empty() && input.empty()) {
+            std::cerr << "ERROR: Invalid input word " << word << "\n";
+            return 1;
+        }
+        conf = Configuration(machine, input);
+    }
+
+    // SIGUSR1 only takes a snapshot, the others also stop the simulation
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    std::signal(SIGUSR1, request_stop);
+
+    Budget budget;
+    if (max_steps < UINT64_MAX - conf.steps)
+        budget.step_limit = conf.steps + max_steps;
+    if (max_seconds > 0)
+        budget.deadline = std::chrono::steady_clock::now() +
+                          std::chrono::seconds(max_seconds);
+
+    LoopDetector loops;
+    Verdict verdict;
+    for (;;) {
+        verdict = run(machine, conf, budget, detect_loops ? &loops : nullptr);
+        if (verdict != Verdict::interrupted) break;
+        if (!snapshot.empty()) save_snapshot(machine, conf, snapshot);
+        if (stop_requested != SIGUSR1) break;
+        stop_requested = 0;
+    }
+
+    std::cout << result_line(verdict, conf, loops) << "\n";
+    if (verdict == Verdict::interrupted && !snapshot.empty())
+        std::cerr << "Snapshot saved to " << snapshot << "\n";
+}
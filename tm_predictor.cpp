@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "errors.h"
+#include "simulator.h"
+#include "step_predictor.h"
+#include "turing_machine.h"
+
+static void print_usage(std::string error) {
+    std::cerr << "ERROR: " << error << "\n"
+              << "Usage: tm_predictor [--max-steps <n>] [--verify]"
+                 " <machine_file> [<input_word>]\n"
+              << "       tm_predictor [--max-steps <n>] [--verify]"
+                 " --inputs <words_file> <machine_file>\n";
+    exit(1);
+}
+
+// runs the converted machine for one step more than predicted, false if it
+// halts differently
+static bool verify(const CompiledMachine &converted, const std::string &word,
+                   const std::vector<std::string> &input,
+                   const Prediction &prediction) {
+    Configuration conf(converted, input);
+    Budget budget;
+    budget.step_limit =
+        prediction.steps < UINT64_MAX ? prediction.steps + 1 : UINT64_MAX;
+    Verdict verdict = run(converted, conf, budget);
+    if (verdict == prediction.verdict && conf.steps == prediction.steps)
+        return true;
+    std::cerr << "MISMATCH on \"" << word << "\": predicted "
+              << to_string(prediction.verdict) << " " << prediction.steps
+              << ", simulated " << to_string(verdict) << " " << conf.steps
+              << "\n";
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t max_steps = UINT64_MAX;
+    bool check = false;
+    std::string inputs;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max-steps" || arg == "--inputs") {
+            if (++i == argc) print_usage("Missing value of " + arg);
+            if (arg == "--max-steps")
+                max_steps = parse_integer(arg, argv[i], print_usage);
+            else
+                inputs = argv[i];
+        } else if (arg == "--verify") {
+            check = true;
+        } else if (arg.starts_with("--")) {
+            print_usage("Unknown option " + arg);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty() || args.size() > (inputs.empty() ? 2 : 1))
+        print_usage("Bad number of arguments");
+
+    std::string filename = args[0];
+    FILE *f = fopen(filename.c_str(), "r");
+    if (!f) {
+        std::cerr << "ERROR: File " << filename << " does not exist\n";
+        return 1;
+    }
+    TuringMachine tm = read_tm_from_file(f);
+    if (tm.num_tapes != 2) {
+        std::cerr << "ERROR: Only two tape machines are converted\n";
+        return 1;
+    }
+    CompiledMachine machine(tm);
+
+    // one word per line, an empty line is the empty word
+    std::vector<std::string> words;
+    if (!inputs.empty()) {
+        std::ifstream words_file(inputs);
+        if (!words_file) {
+            std::cerr << "ERROR: File " << inputs << " does not exist\n";
+            return 1;
+        }
+        for (std::string word; std::getline(words_file, word);)
+            words.push_back(word);
+    } else {
+        words.push_back(args.size() == 2 ? args[1] : "");
+    }
+
+    // the converted machine is only built to check the predictions
+    std::optional<CompiledMachine> converted;
+    if (check) {
+        TuringMachine one = tm;
+        one.twoToOne(ConversionOptions());
+        converted.emplace(one);
+    }
+
+    size_t mismatches = 0, verified = 0;
+    for (const auto &word : words) {
+        std::vector<std::string> input = tm.parse_input(word);
+        if (!word.empty() && input.empty()) {
+            std::cerr << "ERROR: Invalid input word " << word << "\n";
+            return 1;
+        }
+        Prediction prediction = predict_converted(machine, input, max_steps);
+        std::cout << to_string(prediction.verdict) << " " << prediction.steps
+                  << "\n";
+        if (check && prediction.verdict != Verdict::interrupted) {
+            ++verified;
+            if (!verify(*converted, word, input, prediction)) ++mismatches;
+        }
+    }
+    if (check)
+        std::cerr << "Verified " << verified << " words, " << mismatches
+                  << " mismatches\n";
+    return mismatches > 0;
+}
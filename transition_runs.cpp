@@ -0,0 +1,291 @@
+#include "transition_runs.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <queue>
+
+#include "errors.h"
+
+using namespace std;
+
+// at most this many runs of a level are kept, more are merged into one
+static const uint64_t MAX_FAN_IN = 256;
+// every run read by a merge gets at least this much of a buffer
+static const uint64_t MIN_READ_BUFFER = 1 << 16;
+
+// memory taken by the strings of a value
+static uint64_t value_bytes(const TransitionRuns::mapped_type &value) {
+    uint64_t bytes = get<0>(value).size() + get<2>(value).size();
+    for (const auto &letter : get<1>(value))
+        bytes += sizeof letter + letter.size();
+    return bytes;
+}
+
+// memory taken by a buffered transition: its strings and the map node
+static uint64_t entry_bytes(const TransitionRuns::key_type &key,
+                            const TransitionRuns::mapped_type &value) {
+    uint64_t bytes = 144 + key.first.size() + value_bytes(value);
+    for (const auto &letter : key.second)
+        bytes += sizeof letter + letter.size();
+    return bytes;
+}
+
+// numbers are written as they are in memory, strings as their length followed
+// by the characters, vectors as their size followed by the strings
+static uint64_t put_number(FILE *file, uint32_t number) {
+    fwrite(&number, sizeof number, 1, file);
+    return sizeof number;
+}
+
+static uint64_t put_string(FILE *file, const string &text) {
+    uint64_t bytes = put_number(file, text.size());
+    fwrite(text.data(), 1, text.size(), file);
+    return bytes + text.size();
+}
+
+static uint64_t put_strings(FILE *file, const vector<string> &texts) {
+    uint64_t bytes = put_number(file, texts.size());
+    for (const auto &text : texts) bytes += put_string(file, text);
+    return bytes;
+}
+
+static uint64_t put_value(FILE *file,
+                          const TransitionRuns::mapped_type &value) {
+    return put_string(file, get<0>(value)) + put_strings(file, get<1>(value)) +
+           put_string(file, get<2>(value));
+}
+
+static bool get_number(FILE *file, uint32_t &number) {
+    return fread(&number, sizeof number, 1, file) == 1;
+}
+
+static bool get_string(FILE *file, string &text) {
+    uint32_t length;
+    if (!get_number(file, length)) return false;
+    text.resize(length);
+    return fread(text.data(), 1, length, file) == length;
+}
+
+static bool get_strings(FILE *file, vector<string> &texts) {
+    uint32_t size;
+    if (!get_number(file, size)) return false;
+    texts.resize(size);
+    for (auto &text : texts)
+        if (!get_string(file, text)) return false;
+    return true;
+}
+
+static bool get_value(FILE *file, TransitionRuns::mapped_type &value) {
+    return get_string(file, get<0>(value)) &&
+           get_strings(file, get<1>(value)) && get_string(file, get<2>(value));
+}
+
+namespace {
+// the transition at the front of a run during a merge
+struct RunReader {
+    FILE *file;
+    unique_ptr<char[]> buffer;
+    TransitionRuns::key_type key;
+    TransitionRuns::Entry entry;
+
+    // false at the end of the run
+    bool next() {
+        if (!get_string(file, key.first)) {
+            if (!feof(file)) fatal("Reading a run of transitions failed");
+            return false;
+        }
+        uint32_t changed;
+        if (!get_strings(file, key.second) || !get_value(file, entry.value) ||
+            !get_number(file, entry.generator) || !get_number(file, changed))
+            fatal("Reading a run of transitions failed");
+        entry.first.reset();
+        if (changed) {
+            entry.first = make_unique<TransitionRuns::mapped_type>();
+            if (!get_value(file, *entry.first))
+                fatal("Reading a run of transitions failed");
+        }
+        return true;
+    }
+};
+}  // namespace
+
+TransitionRuns::TransitionRuns(const string &dir_, uint64_t memory_limit_,
+                               uint64_t disk_limit_)
+    : dir(dir_),
+      memory_limit(memory_limit_),
+      disk_limit(disk_limit_),
+      fan_in(max<uint64_t>(2,
+                           min(MAX_FAN_IN, memory_limit / MIN_READ_BUFFER))) {
+    // fail before the conversion rather than at the first full buffer
+    if (access(dir.c_str(), W_OK | X_OK) != 0)
+        fatal("Cannot create runs of transitions in " + dir);
+}
+
+TransitionRuns::~TransitionRuns() {
+    for (const auto &run : runs) fclose(run.file);
+}
+
+void TransitionRuns::add(const key_type &key, const mapped_type &value,
+                         WriteCounts &generator) {
+    ++generator.writes;
+    auto [it, added] =
+        buffer.try_emplace(key, Entry{value, generator_index(generator), {}});
+    if (added) {
+        buffered += entry_bytes(key, value);
+        if (buffered >= memory_limit) flush();
+        return;
+    }
+    Entry &entry = it->second;
+    bool changed = entry.value != value;
+    ++(changed ? generator.conflicting : generator.redundant);
+    if (changed && !entry.first) {
+        entry.first = make_unique<mapped_type>(std::move(entry.value));
+        buffered += value_bytes(*entry.first);
+    }
+    entry.value = value;
+}
+
+uint32_t TransitionRuns::generator_index(WriteCounts &generator) {
+    // there are a few dozen generators, and the same one writes many times
+    auto it = find(generators.rbegin(), generators.rend(), &generator);
+    if (it != generators.rend()) return generators.rend() - it - 1;
+    generators.push_back(&generator);
+    return generators.size() - 1;
+}
+
+TransitionRuns::Run TransitionRuns::create_run(unsigned level) {
+    string path = dir + "/run.XXXXXX";
+    int fd = mkstemp(path.data());
+    if (fd < 0) fatal("Cannot create a run of transitions in " + dir);
+    unlink(path.c_str());
+    FILE *file = fdopen(fd, "w+b");
+    if (!file) fatal("Cannot open a run of transitions in " + dir);
+    return {file, 0, level};
+}
+
+// the runs on disk and the one being written never take more than the limit
+void TransitionRuns::write_record(Run &run, const key_type &key,
+                                  const Entry &entry) {
+    uint64_t bytes = put_string(run.file, key.first) +
+                     put_strings(run.file, key.second) +
+                     put_value(run.file, entry.value) +
+                     put_number(run.file, entry.generator) +
+                     put_number(run.file, entry.first != nullptr);
+    if (entry.first) bytes += put_value(run.file, *entry.first);
+    run.bytes += bytes;
+    on_disk += bytes;
+    if (on_disk > disk_limit)
+        fatal("Runs of transitions need more than " +
+              to_string(disk_limit >> 20) + " MiB of disk in " + dir);
+}
+
+// a failed fwrite only sets the error flag of the stream, a later fflush can
+// still succeed and leave a run that ends early at a record boundary
+void TransitionRuns::finish_run(Run &run) {
+    if (fflush(run.file) != 0 || ferror(run.file))
+        fatal("Writing a run of transitions failed");
+}
+
+void TransitionRuns::flush() {
+    if (buffer.empty()) return;
+    Run run = create_run(0);
+    for (const auto &[key, entry] : buffer) write_record(run, key, entry);
+    finish_run(run);
+    runs.push_back(run);
+    buffer.clear();
+    buffered = 0;
+    // the last runs are of the same level when the first of them is
+    while (runs.size() >= fan_in &&
+           runs[runs.size() - fan_in].level == runs.back().level)
+        compact(runs.size() - fan_in);
+}
+
+void TransitionRuns::merge_runs(
+    size_t first,
+    const function<void(const key_type &, const Entry &)> &visit) {
+    const size_t count = runs.size() - first;
+    // the memory of the buffer is shared by the runs
+    const size_t buffer_size = max<uint64_t>(memory_limit / count, 1);
+    vector<RunReader> readers(count);
+    // the smallest key first, on the same key the latest run
+    auto later = [&](size_t a, size_t b) {
+        if (readers[a].key != readers[b].key)
+            return readers[b].key < readers[a].key;
+        return a < b;
+    };
+    priority_queue<size_t, vector<size_t>, decltype(later)> front(later);
+    for (size_t i = 0; i < count; ++i) {
+        // a new stream, so that it gets the buffer before its first read
+        int fd = dup(fileno(runs[first + i].file));
+        if (fd < 0 || lseek(fd, 0, SEEK_SET) != 0 ||
+            !(readers[i].file = fdopen(fd, "rb")))
+            fatal("Cannot read a run of transitions");
+        readers[i].buffer.reset(new char[buffer_size]);
+        setvbuf(readers[i].file, readers[i].buffer.get(), _IOFBF, buffer_size);
+        if (readers[i].next()) front.push(i);
+    }
+
+    while (!front.empty()) {
+        size_t winner = front.top();
+        front.pop();
+        Entry &entry = readers[winner].entry;
+        // older writes of the same key are dropped, from the latest one, and
+        // the first write after each of them is counted against it
+        while (!front.empty() &&
+               readers[front.top()].key == readers[winner].key) {
+            size_t older = front.top();
+            front.pop();
+            Entry &previous = readers[older].entry;
+            WriteCounts &counts = *generators[entry.generator];
+            bool changed = entry.first_value() != previous.value;
+            ++(changed ? counts.conflicting : counts.redundant);
+            // the writes of both runs are now those of the entry
+            entry.generator = previous.generator;
+            if (previous.first_value() == entry.value)
+                entry.first.reset();
+            else if (previous.first)
+                entry.first = std::move(previous.first);
+            else
+                entry.first = make_unique<mapped_type>(previous.value);
+            if (readers[older].next()) front.push(older);
+        }
+        visit(readers[winner].key, entry);
+        if (readers[winner].next()) front.push(winner);
+    }
+    for (auto &reader : readers) fclose(reader.file);
+    for (size_t i = first; i < runs.size(); ++i) {
+        on_disk -= runs[i].bytes;
+        fclose(runs[i].file);
+    }
+    runs.resize(first);
+}
+
+void TransitionRuns::compact(size_t first) {
+    Run merged_run = create_run(runs[first].level + 1);
+    merge_runs(first, [&](const key_type &key, const Entry &entry) {
+        write_record(merged_run, key, entry);
+    });
+    finish_run(merged_run);
+    runs.push_back(merged_run);
+}
+
+void TransitionRuns::merge(
+    const function<void(const key_type &, const mapped_type &)> &visit) {
+    merged = 0;
+    auto counted = [&](const key_type &key, const Entry &entry) {
+        ++merged;
+        visit(key, entry.value);
+    };
+    // nothing went to disk
+    if (runs.empty()) {
+        for (const auto &[key, entry] : buffer) counted(key, entry);
+        buffer.clear();
+        buffered = 0;
+        return;
+    }
+    flush();
+    merge_runs(0, counted);
+}
@@ -0,0 +1,102 @@
+#ifndef __TRANSITION_RUNS_H
+#define __TRANSITION_RUNS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "turing_machine.h"
+
+// Transitions kept out of memory: writes are buffered in a map of bounded size
+// that is written out as a sorted run once full, and the runs are merged into
+// the order of transitions_t when the transitions are read. Runs of the same
+// level are merged into one run of the next level once there are enough of
+// them, so every transition is rewritten once per level. Run files are
+// unlinked as soon as they are created, so nothing is left behind on exit.
+
+class TransitionRuns {
+   public:
+    typedef transition_map_t::key_type key_type;
+    typedef transition_map_t::mapped_type mapped_type;
+
+    // the writes of a key in the buffer or in a run: the value of the last one
+    // and the first one, which is counted against the last write in an older
+    // run
+    struct Entry {
+        mapped_type value;
+        // the generator of the first write, numbered by generator_index
+        uint32_t generator;
+        // the value of the first write, when a later write changed it
+        std::unique_ptr<mapped_type> first;
+
+        const mapped_type &first_value() const {
+            return first ? *first : value;
+        }
+    };
+
+    // runs are created in the directory, at most memory_limit bytes are taken
+    // by the buffer (and later by the merge) and at most disk_limit bytes by
+    // the runs at any time
+    TransitionRuns(const std::string &dir, uint64_t memory_limit,
+                   uint64_t disk_limit);
+    ~TransitionRuns();
+
+    TransitionRuns(const TransitionRuns &) = delete;
+    TransitionRuns &operator=(const TransitionRuns &) = delete;
+
+    // the last write of a key wins, as in transitions_t; the write is counted
+    // for the generator as in transitions_t, against an older write of the
+    // same key in the buffer at once, against one in an older run by the merge
+    void add(const key_type &key, const mapped_type &value,
+             WriteCounts &generator);
+
+    // visits every transition once in the order of transitions_t, the runs
+    // are consumed
+    void merge(const std::function<void(const key_type &, const mapped_type &)>
+                   &visit);
+
+    // transitions visited by merge
+    uint64_t size() const { return merged; }
+
+   private:
+    struct Run {
+        FILE *file;
+        uint64_t bytes;
+        // 0 for a written buffer, one more than the merged runs otherwise
+        unsigned level;
+    };
+
+    std::string dir;
+    uint64_t memory_limit, disk_limit;
+    // runs merged at a time
+    size_t fan_in;
+    std::map<key_type, Entry> buffer;
+    uint64_t buffered = 0;
+    // oldest first, a later run wins on the same key; the levels never grow
+    // towards the end
+    std::vector<Run> runs;
+    uint64_t on_disk = 0;
+    uint64_t merged = 0;
+    // the generators of the writes, numbered in the runs
+    std::vector<WriteCounts *> generators;
+
+    // writes the buffer as a new run
+    void flush();
+    Run create_run(unsigned level);
+    uint32_t generator_index(WriteCounts &generator);
+    void write_record(Run &run, const key_type &key, const Entry &entry);
+    // fails unless everything written to the run reached the file
+    void finish_run(Run &run);
+    // merges the runs from the first one to the end into a single one
+    void compact(size_t first);
+    // the merged runs are closed and removed
+    void merge_runs(
+        size_t first,
+        const std::function<void(const key_type &, const Entry &)> &visit);
+};
+
+#endif
@@ -2,15 +2,25 @@
 
 #include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <numeric>
+#include <optional>
 #include <ranges>
 #include <set>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
+#include "transition_runs.h"
+
 using namespace std;
 
 //--------------CONVERSION IMPLEMENTATION--------------------//
@@ -64,6 +74,82 @@ const std::string mutateSecond = "(mtxS)";
 // separator reject
 const std::string checkFall = "(winfall)";
 const std::string die = "(die)";
+
+// fused step protocol, pending first tape update is carried in the state
+const std::string leaveSecond = "(lvS)";
+const std::string placeSecond = "(plS)";
+const std::string eraseSecond = "(ersS)";
+const std::string shiftSecondLeft = "(sSL)";
+const std::string searchPending = "(srchP)";
+const std::string applyFirst = "(apF)";
+const std::string passFirst = "(psF)";
+const std::string readFirst = "(rdF)";
+const std::string carryFirst = "(crF)";
+
+// codeword tape preparation, input letters are encoded from the last one
+const std::string encodeSeekEnd = "(encSE)";
+const std::string encodeOpen = "(encO)";
+const std::string encodeSeekInput = "(encSI)";
+const std::string encodeCarry = "(encC)";
+const std::string encodeWrite = "(encW)";
+const std::string encodeClose = "(encCl)";
+const std::string encodeCarryLast = "(encCL)";
+const std::string encodeWriteLast = "(encWL)";
+const std::string encodeFinish = "(encF)";
+
+// codeword step protocol, letters are read and written digit by digit
+const std::string codeReadFirst = "(cRF)";
+const std::string codeReturnFirst = "(cRtF)";
+const std::string codeSearchSecond = "(cSS)";
+const std::string codeReadSecond = "(cRS)";
+const std::string codeWriteSecond = "(cWS)";
+const std::string codeMoveSecond = "(cMS)";
+const std::string codeSkipRight = "(cSkR)";
+const std::string codeSkipLeft = "(cSkL)";
+const std::string codeResize = "(cRsz)";
+const std::string codeAfterResize = "(cARsz)";
+const std::string codeSearchPending = "(cSP)";
+const std::string codeWriteFirst = "(cWF)";
+const std::string codePlaceFirst = "(cPF)";
+const std::string codePassFirst = "(cPsF)";
+const std::string codeReadRight = "(cRR)";
+const std::string codeCarryFirst = "(cCF)";
+const std::string codeShift = "(cSft)";
+const std::string codeShiftBack = "(cSftB)";
+const std::string codeAfterShift = "(cASft)";
+
+// in-place tape preparation, the input is left where it is
+const std::string markSeekEnd = "(mSE)";
+const std::string markPlaceSecond = "(mPS)";
+const std::string markPlaceGuard = "(mPG)";
+const std::string markSkipSecond = "(mSkS)";
+const std::string markSeekFirst = "(mSF)";
+
+// block speedup tape preparation, the input is gathered into blocks
+const std::string blockGather = "(bkG)";
+const std::string blockCarry = "(bkC)";
+const std::string blockWrite = "(bkW)";
+const std::string blockCarryLast = "(bkCL)";
+const std::string blockWriteLast = "(bkWL)";
+const std::string blockSkip = "(bkS)";
+const std::string blockErase = "(bkE)";
+const std::string blockReturn = "(bkR)";
+
+// block speedup step, the original state with the offsets of the heads
+const std::string blockStep = "(bkM)";
+
+// in-place step protocol, the heads are marked letters
+const std::string markSearchSecond = "(mSS)";
+const std::string markRightSecond = "(mRS)";
+const std::string markResizeSecond = "(mRzS)";
+const std::string markAfterResize = "(mARz)";
+const std::string markLeftSecond = "(mLS)";
+const std::string markSearchPending = "(mSP)";
+const std::string markRightFirst = "(mRF)";
+const std::string markLeftFirst = "(mLF)";
+const std::string markCheckFall = "(mCF)";
+const std::string markShift = "(mSft)";
+const std::string markAfterShift = "(mASft)";
 }  // namespace state
 
 namespace move {
@@ -90,6 +176,19 @@ const std::string separatorIndicator = "Sep";
 // determines the end of tape when resizing/shifting
 const std::string rightGuardIdicator = "RG";
 const std::string reversePlaceholder = "Rv";
+// digits of codewords
+const std::string digitIndicator = "Dg";
+// the first input letter, which ends the encoding of the input
+const std::string firstInputIndicator = "Fi";
+// letter under a head in the in-place layout
+const std::string headMarkIndicator = "Hd";
+// blocks of cells in the block speedup, the first one is marked while the
+// input is gathered into blocks
+const std::string blockIndicator = "Bk";
+const std::string firstBlockIndicator = "Bf";
+// cells the input was gathered from
+const std::string vacatedIndicator = "Vc";
+const std::string firstVacatedIndicator = "Vf";
 }  // namespace letter
 
 // actual unique letters using letter:: namespace
@@ -103,20 +202,55 @@ std::vector<std::string> alphabet;
 // original working alphabet + leftGuard + rightGuard + separator +
 // letter::headIndicator
 std::vector<std::string> extAlphabet;
-// extAlphabet - separator
-std::vector<std::string> extAlphabetNoSep;
 // all the original machine's states
 std::vector<std::string> originalStates;
 
+// codeword conversion only, digit cells with digits[0] used for the blank
+std::vector<std::string> digits;
+// number of digits of every codeword and powers of the base up to it
+size_t width;
+std::vector<size_t> powers;
+// working alphabet letter <-> codeword, the blank's codeword is 0
+std::map<std::string, size_t> codeOf;
+std::vector<std::string> letterOf;
+// the marked copy of the first input letter
+std::map<std::string, std::string> firstInput;
+
+// in-place conversion only, working alphabet letter -> the same letter under a
+// head
+std::map<std::string, std::string> marked;
+
+// counts of the generator that is running, the writes outside of generators
+// are counted as "other"
+std::map<std::string, WriteCounts> counts;
+WriteCounts *counted = &counts["other"];
+
+// the writes until the end of the scope are counted for the generator
+class CountWrites {
+   public:
+    explicit CountWrites(const char *generator) : previous(counted) {
+        counted = &counts[generator];
+    }
+    ~CountWrites() { counted = previous; }
+
+   private:
+    WriteCounts *previous;
+};
+
+// new symbols are longest letter + something ensuring uniqueness
+std::string longestInputLetter(const TuringMachine &tm) {
+    return *std::ranges::max_element(
+        tm.input_alphabet,
+        [](std::string a, std::string b) { return a.size() < b.size(); });
+}
+
 void prepareGlobals(const TuringMachine &tm) {
     // define states
     originalStates = tm.set_of_states();
 
     // defining new symbols as longest letter + something ensuring uniqueness of
     // guard and separator
-    std::string longest = *std::ranges::max_element(
-        tm.input_alphabet,
-        [](std::string a, std::string b) { return a.size() < b.size(); });
+    std::string longest = longestInputLetter(tm);
     leftGuard = p(letter::leftGuardIndicator + longest);
     rightGuard = p(letter::rightGuardIdicator + longest);
     separator = p(letter::separatorIndicator + longest);
@@ -124,21 +258,33 @@ void prepareGlobals(const TuringMachine &tm) {
 
     // define alphabets
     alphabet = tm.working_alphabet();
-    extAlphabetNoSep = alphabet;
+    extAlphabet = alphabet;
     std::ranges::copy(std::vector<std::string>{leftGuard, rightGuard, separator,
                                                letter::headIndicator},
-                      std::back_inserter(extAlphabetNoSep));
-    extAlphabet = extAlphabetNoSep;
-    extAlphabet.push_back(separator);
+                      std::back_inserter(extAlphabet));
+}
+
+// letters except the one that gets its own transition, so that every
+// transition is written once
+std::vector<std::string> without(const std::vector<std::string> &letters,
+                                 const std::string &handled) {
+    std::vector<std::string> rest;
+    std::ranges::copy_if(letters, std::back_inserter(rest),
+                         [&](const auto &letter) { return letter != handled; });
+    return rest;
 }
 
 // creates tape for the converted machine to recognize
 transitions_t &&addTapePreparators(transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    // the blank is handled separately by every state reading the input
+    const auto nonBlank = without(alphabet, BLANK);
     for (const auto &letter : alphabet) {
-        // initial guard insert and copying
-        transitions[{INITIAL_STATE, {letter}}] = {
-            p(state::placeLeftGuard + letter), {leftGuard}, move::right};
-        std::ranges::for_each(alphabet, [&](const auto &current) {
+        // initial guard insert and copying, a blank is the empty word
+        if (letter != BLANK)
+            transitions[{INITIAL_STATE, {letter}}] = {
+                p(state::placeLeftGuard + letter), {leftGuard}, move::right};
+        std::ranges::for_each(nonBlank, [&](const auto &current) {
             transitions[{p(state::placeLeftGuard + letter), {current}}] = {
                 p(state::placeLeftGuard + current), {letter}, move::right};
         });
@@ -148,10 +294,8 @@ transitions_t &&addTapePreparators(transitions_t &&transitions) {
         // reversing input
         transitions[{state::reverseFind, {letter}}] = {
             p(state::reversePlace + letter), {reverseIndicator}, move::right};
-        transitions[{state::reverseFind, {reverseIndicator}}] = {
-            state::reverseFind, {reverseIndicator}, move::left};
 
-        std::ranges::for_each(alphabet, [&](const auto &current) {
+        std::ranges::for_each(nonBlank, [&](const auto &current) {
             transitions[{p(state::reversePlace + letter), {current}}] = {
                 p(state::reversePlace + letter), {current}, move::right};
         });
@@ -163,11 +307,12 @@ transitions_t &&addTapePreparators(transitions_t &&transitions) {
         transitions[{state::reverseSkip, {letter}}] = {
             state::reverseSkip, {letter}, move::left};
 
-        // adding head indicator slots
-        transitions[{state::prepareFirstTape, {letter}}] = {
-            p(state::prepareFirstTape + letter),
-            {reverseIndicator},
-            move::left};
+        // adding head indicator slots, a blank ends the input
+        if (letter != BLANK)
+            transitions[{state::prepareFirstTape, {letter}}] = {
+                p(state::prepareFirstTape + letter),
+                {reverseIndicator},
+                move::left};
         transitions[{p(state::prepareFirstTape + letter), {reverseIndicator}}] =
             {p(state::prepareFirstTape + letter),
              {reverseIndicator},
@@ -181,10 +326,12 @@ transitions_t &&addTapePreparators(transitions_t &&transitions) {
         transitions[{p(state::prepareFirstTape + letter + "1"),
                      {reverseIndicator}}] = {
             p(state::prepareFirstTape + "2"), {letter}, move::right};
-        transitions[{p(state::prepareFirstTape + "2"), {reverseIndicator}}] = {
-            state::prepareFirstTape, {BLANK}, move::right};
     }
     // some left-overs independent from letters
+    transitions[{state::reverseFind, {reverseIndicator}}] = {
+        state::reverseFind, {reverseIndicator}, move::left};
+    transitions[{p(state::prepareFirstTape + "2"), {reverseIndicator}}] = {
+        state::prepareFirstTape, {BLANK}, move::right};
     transitions[{state::reverseFind, {leftGuard}}] = {
         state::prepareFirstTape, {leftGuard}, move::right};
 
@@ -229,8 +376,10 @@ transitions_t &&addTapePreparators(transitions_t &&transitions) {
     return std::move(transitions);
 }
 
-// adds states for the purpose of resizing/shifting the tape
-transitions_t &&addResizers(transitions_t &&transitions) {
+// adds states for the purpose of shifting the tape when the first head
+// reaches the left guard
+transitions_t &&addLeftShifters(transitions_t &&transitions) {
+    const CountWrites counting(__func__);
     // optimize number of states by creating alphabet + separator
     std::vector<std::string> alphabetSep = alphabet;
     alphabetSep.push_back(separator);
@@ -243,35 +392,6 @@ transitions_t &&addResizers(transitions_t &&transitions) {
             move::right};
 
         for (const auto &letter : alphabetSep) {
-            // resizing right tape works a little bit different from shifting
-            // so new states are necessary
-            // start resizing
-            transitions[{p(state::mutateSecond + state + letter),
-                         {rightGuard}}] = {
-                p(state::resizeRight1 + state + letter),
-                {letter::headIndicator},
-                move::right};
-            // continue resizing
-            transitions[{p(state::resizeRight1 + state + letter), {BLANK}}] = {
-                p(state::resizeRight2 + state + letter), {BLANK}, move::right};
-            // resizing done go back to the head
-            transitions[{p(state::resizeRight2 + state + letter), {BLANK}}] = {
-                p(state::afterResizeSearch + state + letter),
-                {rightGuard},
-                move::left};
-            // we must encounter BLANK here
-            transitions[{p(state::afterResizeSearch + state + letter),
-                         {BLANK}}] = {
-                p(state::afterResizeSearch + state + letter),
-                {BLANK},
-                move::left};
-            // resizing done continue with the algorithm
-            transitions[{p(state::afterResizeSearch + state + letter),
-                         {letter::headIndicator}}] = {
-                p(state::searchFirst + state + letter),
-                {letter::headIndicator},
-                move::left};
-
             // initial erasure + later head shift on the second tape
             std::ranges::for_each(alphabet, [&](const auto &letterToRemember) {
                 transitions[{p(state::shiftInsertHead1 + state + letter),
@@ -318,11 +438,9 @@ transitions_t &&addResizers(transitions_t &&transitions) {
                 move::right};
 
             // continue shifting guard
-            std::ranges::for_each(alphabet, [&](const auto &letterToRemember) {
-                transitions[{p(state::shiftInsertGuard1 + state + letter),
-                             {BLANK}}] = {
-                    p(state::shiftInsertGuard2 + state), {letter}, move::right};
-            });
+            transitions[{p(state::shiftInsertGuard1 + state + letter),
+                         {BLANK}}] = {
+                p(state::shiftInsertGuard2 + state), {letter}, move::right};
 
             // search for the second's tape head after shifting
             transitions[{p(state::afterShiftSearch + state), {letter}}] = {
@@ -343,9 +461,52 @@ transitions_t &&addResizers(transitions_t &&transitions) {
     return std::move(transitions);
 }
 
+// adds states for the purpose of resizing the right end of the tape, for every
+// key the resizing starts in (from + key) standing on the right guard and ends
+// in (to + key) one cell left of the newly placed head indicator
+transitions_t &&addRightResizers(transitions_t &&transitions,
+                                 const std::string &from, const std::string &to,
+                                 const std::vector<std::string> &keys) {
+    const CountWrites counting(__func__);
+    for (const auto &key : keys) {
+        // resizing right tape works a little bit different from shifting
+        // so new states are necessary
+        // start resizing
+        transitions[{p(from + key), {rightGuard}}] = {
+            p(state::resizeRight1 + key), {letter::headIndicator}, move::right};
+        // continue resizing
+        transitions[{p(state::resizeRight1 + key), {BLANK}}] = {
+            p(state::resizeRight2 + key), {BLANK}, move::right};
+        // resizing done go back to the head
+        transitions[{p(state::resizeRight2 + key), {BLANK}}] = {
+            p(state::afterResizeSearch + key), {rightGuard}, move::left};
+        // we must encounter BLANK here
+        transitions[{p(state::afterResizeSearch + key), {BLANK}}] = {
+            p(state::afterResizeSearch + key), {BLANK}, move::left};
+        // resizing done continue with the algorithm
+        transitions[{p(state::afterResizeSearch + key),
+                     {letter::headIndicator}}] = {
+            p(to + key), {letter::headIndicator}, move::left};
+    }
+
+    return std::move(transitions);
+}
+
+// the second head is resized with the state and the letter of the first head
+// remembered
+std::vector<std::string> resizeKeys() {
+    std::vector<std::string> keys;
+    for (const auto &state : originalStates) {
+        for (const auto &letter : alphabet) keys.push_back(state + letter);
+        keys.push_back(state + separator);
+    }
+    return keys;
+}
+
 // add state that ensures the machine's demise in the same way as on 2 tape
 // machine
 transitions_t &&addSeparatorRejects(transitions_t &&transitions) {
+    const CountWrites counting(__func__);
     // we want to preserve the error message for being out of bounds so we are
     // going to produce it by going left to the -1 index
     std::ranges::for_each(extAlphabet, [&](const auto &letter) {
@@ -355,8 +516,10 @@ transitions_t &&addSeparatorRejects(transitions_t &&transitions) {
     return std::move(transitions);
 }
 
-// add states that bounce between left and right head
-transitions_t &&addSearchersAndFetchers(transitions_t &&transitions) {
+// add states that fetch the first head's letter and carry it to the second head
+transitions_t &&addFirstFetchers(transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    const auto toSkipAll = without(extAlphabet, letter::headIndicator);
     // intial search
     transitions[{state::searchFirst, {letter::headIndicator}}] = {
         p(state::fetchFirst + INITIAL_STATE),
@@ -365,11 +528,9 @@ transitions_t &&addSearchersAndFetchers(transitions_t &&transitions) {
 
     for (const auto &state : originalStates) {
         for (const auto &letter : alphabet) {
-            // simple fetcher states to get head's letter
+            // simple fetcher state to get head's letter
             transitions[{p(state::fetchFirst + state), {letter}}] = {
                 p(state::fetchedFirst + state + letter), {letter}, move::right};
-            transitions[{p(state::fetchSecond + state), {letter}}] = {
-                p(state::fetchedSecond + state + letter), {letter}, move::left};
 
             // go search right head
             transitions[{p(state::fetchedFirst + state + letter),
@@ -377,23 +538,50 @@ transitions_t &&addSearchersAndFetchers(transitions_t &&transitions) {
                 p(state::searchSecond + state + letter),
                 {letter::headIndicator},
                 move::right};
-            // go search left head
-            transitions[{p(state::fetchedSecond + state + letter),
-                         {letter::headIndicator}}] = {
-                p(state::searchFirst + state + letter),
-                {letter::headIndicator},
-                move::left};
 
             // skip everything along the way during search
-            std::ranges::for_each(extAlphabet, [&](const auto &toSkip) {
+            std::ranges::for_each(toSkipAll, [&](const auto &toSkip) {
                 transitions[{p(state::searchSecond + state + letter),
                              {toSkip}}] = {
                     p(state::searchSecond + state + letter),
                     {toSkip},
                     move::right};
             });
+
+            // found the head
+            transitions[{p(state::searchSecond + state + letter),
+                         {letter::headIndicator}}] = {
+                p(state::fetchSecond + state + letter),
+                {letter::headIndicator},
+                move::right};
+        }
+        // found the place to put the head
+        transitions[{p(state::mutateFirst + state), {BLANK}}] = {
+            p(state::fetchFirst + state), {letter::headIndicator}, move::left};
+    }
+
+    return std::move(transitions);
+}
+
+// add states that bounce between left and right head
+transitions_t &&addSearchersAndFetchers(transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    const auto toSkipAll = without(extAlphabet, letter::headIndicator);
+    for (const auto &state : originalStates) {
+        for (const auto &letter : alphabet) {
+            // simple fetcher state to get head's letter
+            transitions[{p(state::fetchSecond + state), {letter}}] = {
+                p(state::fetchedSecond + state + letter), {letter}, move::left};
+
+            // go search left head
+            transitions[{p(state::fetchedSecond + state + letter),
+                         {letter::headIndicator}}] = {
+                p(state::searchFirst + state + letter),
+                {letter::headIndicator},
+                move::left};
+
             // skip everything along the way searching the left indicator
-            std::ranges::for_each(extAlphabet, [&](const auto &toSkip) {
+            std::ranges::for_each(toSkipAll, [&](const auto &toSkip) {
                 transitions[{p(state::searchFirst + state + letter),
                              {toSkip}}] = {
                     p(state::searchFirst + state + letter),
@@ -402,11 +590,6 @@ transitions_t &&addSearchersAndFetchers(transitions_t &&transitions) {
             });
 
             // found the head
-            transitions[{p(state::searchSecond + state + letter),
-                         {letter::headIndicator}}] = {
-                p(state::fetchSecond + state + letter),
-                {letter::headIndicator},
-                move::right};
             transitions[{p(state::searchFirst + state + letter),
                          {letter::headIndicator}}] = {
                 p(state::fetchFirst + state + letter),
@@ -434,9 +617,9 @@ transitions_t &&addSearchersAndFetchers(transitions_t &&transitions) {
     return std::move(transitions);
 }
 
-// main simulator states
-transitions_t &&addMutators(const TuringMachine &tm,
-                            transitions_t &&transitions) {
+// add states that accept only if the first head does not fall off the tape
+transitions_t &&addFallCheckers(transitions_t &&transitions) {
+    const CountWrites counting(__func__);
     // false accept states
     transitions[{p(state::checkFall + move::rightId),
                  {letter::headIndicator}}] = {
@@ -445,13 +628,21 @@ transitions_t &&addMutators(const TuringMachine &tm,
         {ACCEPTING_STATE, {letter::headIndicator}, move::stay};
     transitions[{p(state::checkFall + move::leftId), {letter::headIndicator}}] =
         {p(state::checkFall + "1"), {letter::headIndicator}, move::right};
-    std::ranges::for_each(extAlphabet, [&](const auto &letter) {
-        transitions[{p(state::checkFall + "1"), {letter}}] = {
-            ACCEPTING_STATE, {letter}, move::stay};
-    });
+    std::ranges::for_each(
+        without(extAlphabet, separator), [&](const auto &letter) {
+            transitions[{p(state::checkFall + "1"), {letter}}] = {
+                ACCEPTING_STATE, {letter}, move::stay};
+        });
     transitions[{p(state::checkFall + "1"), {separator}}] = {
         state::die, {separator}, move::left};
 
+    return std::move(transitions);
+}
+
+// main simulator states
+transitions_t &&addMutators(const TuringMachine &tm,
+                            transitions_t &&transitions) {
+    const CountWrites counting(__func__);
     // consider every combination of letters and states
     for (const auto &state : originalStates) {
         for (const auto &letter1 : alphabet) {
@@ -509,16 +700,6 @@ transitions_t &&addMutators(const TuringMachine &tm,
                     {letter2}}] = {p(state::mutateFirst + state + move::leftId),
                                    {letter1},
                                    move::right};
-                // going left is going right on the virtual first tape and
-                // requires multiple steps
-                transitions[{p(state::mutateFirst + state + move::leftId),
-                             {BLANK}}] = {
-                    p(state::mutateFirst + state + "2" + move::leftId),
-                    {BLANK},
-                    move::right};
-                transitions[{p(state::mutateFirst + state + move::leftId),
-                             {separator}}] = {
-                    p(state::die), {separator}, move::left};
 
                 // direction stay
                 transitions[{
@@ -542,17 +723,6 @@ transitions_t &&addMutators(const TuringMachine &tm,
                     {letter1},
                     move::left};
 
-                // going left requires multiple steps
-                transitions[{
-                    p(state::mutateSecond + state + letter1 + move::leftId),
-                    {BLANK}}] = {p(state::mutateSecond + state + letter1 + "2" +
-                                   move::leftId),
-                                 {BLANK},
-                                 move::left};
-                transitions[{
-                    p(state::mutateSecond + state + letter1 + move::leftId),
-                    {separator}}] = {p(state::die), {separator}, move::left};
-
                 transitions[{p(state::mutateSecond + state + letter2 + "2" +
                                move::leftId),
                              {letter1}}] = {
@@ -578,6 +748,17 @@ transitions_t &&addMutators(const TuringMachine &tm,
                     {letter1},
                     move::right};
             }
+            // going left on the second tape requires multiple steps
+            transitions[{
+                p(state::mutateSecond + state + letter1 + move::leftId),
+                {BLANK}}] = {p(state::mutateSecond + state + letter1 + "2" +
+                               move::leftId),
+                             {BLANK},
+                             move::left};
+            transitions[{
+                p(state::mutateSecond + state + letter1 + move::leftId),
+                {separator}}] = {p(state::die), {separator}, move::left};
+
             // next step places the head after right mutation on the first tape
             transitions[{p(state::mutateFirst + state + "2" + move::leftId),
                          {letter1}}] = {
@@ -589,25 +770,1232 @@ transitions_t &&addMutators(const TuringMachine &tm,
                 {letter::headIndicator},
                 move::left};
         }
-        // found the place to put the head
-        transitions[{p(state::mutateFirst + state), {BLANK}}] = {
-            p(state::fetchFirst + state), {letter::headIndicator}, move::left};
+        // going left is going right on the virtual first tape and requires
+        // multiple steps
+        transitions[{p(state::mutateFirst + state + move::leftId), {BLANK}}] = {
+            p(state::mutateFirst + state + "2" + move::leftId),
+            {BLANK},
+            move::right};
+        transitions[{p(state::mutateFirst + state + move::leftId),
+                     {separator}}] = {p(state::die), {separator}, move::left};
     }
 
     return std::move(transitions);
 }
+
+// pending update of the first tape carried back from the second head
+std::string pending(const std::string &newState, const std::string &newLetter,
+                    const char mv) {
+    return newState + newLetter + move::id(mv);
+}
+
+// fused simulator states, the whole transition is known at the second head so
+// the first head's update is carried back in the state instead of being
+// recomputed after fetching the first letter once again
+transitions_t &&addFusedMutators(const TuringMachine &tm,
+                                 transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    const auto toSkipAll = without(extAlphabet, letter::headIndicator);
+    // pending update -> (new state, new letter, direction) on the first tape
+    std::map<std::string, std::tuple<std::string, std::string, char>> pendings;
+    for (const auto &[from, to] : tm.transitions) {
+        const auto &[state, letters] = from;
+        const auto &[newState, newLetters, moves] = to;
+        // reject rejecting states, no need to go back to the first head
+        if (newState == REJECTING_STATE) {
+            transitions[{p(state::fetchSecond + state + letters[0]),
+                         {letters[1]}}] = {
+                REJECTING_STATE, {letters[1]}, move::stay};
+            continue;
+        }
+        const std::string pend = pending(newState, newLetters[0], moves[0]);
+        pendings[pend] = {newState, newLetters[0], moves[0]};
+
+        // mutate the second head right away, unless it moves right the
+        // indicator on the left has to be visited next
+        const std::string mutated =
+            moves[1] == HEAD_STAY    ? state::leaveSecond
+            : moves[1] == HEAD_RIGHT ? state::placeSecond
+                                     : state::shiftSecondLeft;
+        transitions[{p(state::fetchSecond + state + letters[0]),
+                     {letters[1]}}] = {
+            p(mutated + pend),
+            {newLetters[1]},
+            moves[1] == HEAD_RIGHT ? move::right : move::left};
+    }
+
+    for (const auto &[pend, update] : pendings) {
+        // direction stay, skip the second head's indicator
+        transitions[{p(state::leaveSecond + pend), {letter::headIndicator}}] = {
+            p(state::searchPending + pend),
+            {letter::headIndicator},
+            move::left};
+
+        // direction right, place the new indicator and erase the old one on
+        // the way back
+        transitions[{p(state::placeSecond + pend), {BLANK}}] = {
+            p(state::eraseSecond + pend), {letter::headIndicator}, move::left};
+        std::ranges::for_each(alphabet, [&](const auto &toSkip) {
+            transitions[{p(state::eraseSecond + pend), {toSkip}}] = {
+                p(state::eraseSecond + pend), {toSkip}, move::left};
+        });
+        transitions[{p(state::eraseSecond + pend), {letter::headIndicator}}] = {
+            p(state::searchPending + pend), {BLANK}, move::left};
+
+        // direction left, erase the indicator and place it one cell earlier
+        transitions[{p(state::shiftSecondLeft + pend),
+                     {letter::headIndicator}}] = {
+            p(state::shiftSecondLeft + pend + "2"), {BLANK}, move::left};
+        std::ranges::for_each(alphabet, [&](const auto &toSkip) {
+            transitions[{p(state::shiftSecondLeft + pend + "2"), {toSkip}}] = {
+                p(state::shiftSecondLeft + pend + "3"), {toSkip}, move::left};
+        });
+        transitions[{p(state::shiftSecondLeft + pend + "2"), {separator}}] = {
+            state::die, {separator}, move::left};
+        transitions[{p(state::shiftSecondLeft + pend + "3"), {BLANK}}] = {
+            p(state::searchPending + pend),
+            {letter::headIndicator},
+            move::left};
+
+        // skip everything along the way searching the left indicator
+        std::ranges::for_each(toSkipAll, [&](const auto &toSkip) {
+            transitions[{p(state::searchPending + pend), {toSkip}}] = {
+                p(state::searchPending + pend), {toSkip}, move::left};
+        });
+    }
+
+    // found the first head, apply the pending update
+    for (const auto &[pend, update] : pendings) {
+        const auto &[newState, newLetter, mv] = update;
+        const std::pair<std::string, std::vector<std::string>> found = {
+            p(state::searchPending + pend), {letter::headIndicator}};
+
+        // accept accepting states
+        if (newState == ACCEPTING_STATE) {
+            transitions[found] = {p(state::checkFall + move::id(mv)),
+                                  {letter::headIndicator},
+                                  move::stay};
+            continue;
+        }
+        transitions[found] = {
+            p(state::applyFirst + pend),
+            {mv == HEAD_STAY ? letter::headIndicator : BLANK},
+            move::left};
+
+        std::ranges::for_each(alphabet, [&](const auto &current) {
+            // direction stay, the new letter is already known
+            if (mv == HEAD_STAY)
+                transitions[{p(state::applyFirst + pend), {current}}] = {
+                    p(state::fetchedFirst + newState + newLetter),
+                    {newLetter},
+                    move::right};
+            // direction right, going right is going left on the virtual first
+            // tape, the head is placed as after the regular mutation
+            else if (mv == HEAD_RIGHT)
+                transitions[{p(state::applyFirst + pend), {current}}] = {
+                    p(state::mutateFirst + newState), {newLetter}, move::left};
+            // direction left, the next letter is read on the way to the
+            // indicator
+            else
+                transitions[{p(state::applyFirst + pend), {current}}] = {
+                    p(state::passFirst + newState), {newLetter}, move::right};
+        });
+    }
+
+    for (const auto &state : originalStates) {
+        transitions[{p(state::passFirst + state), {BLANK}}] = {
+            p(state::readFirst + state), {BLANK}, move::right};
+        transitions[{p(state::readFirst + state), {separator}}] = {
+            state::die, {separator}, move::left};
+        for (const auto &letter : alphabet) {
+            transitions[{p(state::readFirst + state), {letter}}] = {
+                p(state::carryFirst + state + letter), {letter}, move::right};
+            transitions[{p(state::carryFirst + state + letter), {BLANK}}] = {
+                p(state::searchSecond + state + letter),
+                {letter::headIndicator},
+                move::right};
+        }
+    }
+
+    // the second head is resized with the pending update remembered
+    std::vector<std::string> keys;
+    for (const auto &[pend, update] : pendings) keys.push_back(pend);
+    return addRightResizers(std::move(transitions), state::placeSecond,
+                            state::eraseSecond, keys);
+}
+
+// the working alphabet is encoded in codewords of a fixed width over the base,
+// the tape alphabet of the converted machine no longer depends on the working
+// alphabet
+void prepareCodewords(const TuringMachine &tm, size_t base) {
+    std::string longest = longestInputLetter(tm);
+    digits.clear();
+    for (size_t digit = 0; digit < base; ++digit)
+        digits.push_back(
+            p(letter::digitIndicator + std::to_string(digit) + longest));
+    firstInput.clear();
+    for (const auto &letter : tm.input_alphabet)
+        firstInput[letter] = p(letter::firstInputIndicator + letter + longest);
+
+    // the blank gets the codeword 0, so a cell of zero digits is blank
+    letterOf = {BLANK};
+    std::ranges::copy_if(alphabet, std::back_inserter(letterOf),
+                         [](const auto &letter) { return letter != BLANK; });
+    codeOf.clear();
+    for (size_t code = 0; code < letterOf.size(); ++code)
+        codeOf[letterOf[code]] = code;
+    powers = {1};
+    while (powers.back() < letterOf.size())
+        powers.push_back(powers.back() * base);
+    width = std::max<size_t>(powers.size() - 1, 1);
+    if (powers.size() == 1) powers.push_back(base);
+
+    // tape letters of the simulation, input letters are all encoded by then
+    extAlphabet = digits;
+    std::ranges::copy(std::vector<std::string>{BLANK, leftGuard, rightGuard,
+                                               separator,
+                                               letter::headIndicator},
+                      std::back_inserter(extAlphabet));
+}
+
+// digit of the codeword at the position, position 0 is next to the indicator
+const std::string &digitOf(size_t code, size_t position) {
+    return digits[code / powers[position] % digits.size()];
+}
+
+// the first digits read of a codeword and the value they add up to
+std::string readPrefix(size_t read, size_t value) {
+    return p(std::to_string(read) + "-" + std::to_string(value));
+}
+
+// writes the letter's codeword starting at the cell of the right guard (or
+// at a blank cell without a carry state), the most significant digit first,
+// then continues in done
+void addEncoder(transitions_t &transitions, const std::string &carry,
+                const std::string &write, const std::string &letter,
+                const std::string &done) {
+    if (!carry.empty())
+        transitions[{p(carry + letter), {rightGuard}}] = {
+            p(write + letter + p(std::to_string(width - 1))),
+            {BLANK},
+            move::stay};
+    for (size_t position = 0; position < width; ++position)
+        transitions[{p(write + letter + p(std::to_string(position))),
+                     {BLANK}}] = {
+            position > 0 ? p(write + letter + p(std::to_string(position - 1)))
+                         : done,
+            {digitOf(codeOf[letter], position)},
+            move::right};
+}
+
+// creates the tape of the codeword conversion, the input is encoded right of
+// itself from its last letter, the first virtual tape ends up reversed:
+// _.._ LG [digits 1] ... [digits 1] Sep [1 digits] RG
+transitions_t &&addCodewordPreparators(const TuringMachine &tm,
+                                       transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    std::vector<std::string> encoded = digits;
+    encoded.push_back(BLANK);
+    encoded.push_back(leftGuard);
+
+    for (const auto &letter : tm.input_alphabet) {
+        // mark the first letter and open the encoding after the input
+        transitions[{INITIAL_STATE, {letter}}] = {
+            state::encodeSeekEnd, {firstInput[letter]}, move::right};
+        transitions[{state::encodeSeekEnd, {letter}}] = {
+            state::encodeSeekEnd, {letter}, move::right};
+
+        // take the last letter left and carry it to the end
+        transitions[{state::encodeSeekInput, {letter}}] = {
+            p(state::encodeCarry + letter), {BLANK}, move::right};
+        transitions[{state::encodeSeekInput, {firstInput[letter]}}] = {
+            p(state::encodeCarryLast + letter), {BLANK}, move::right};
+        std::ranges::for_each(encoded, [&](const auto &toSkip) {
+            transitions[{p(state::encodeCarry + letter), {toSkip}}] = {
+                p(state::encodeCarry + letter), {toSkip}, move::right};
+            transitions[{p(state::encodeCarryLast + letter), {toSkip}}] = {
+                p(state::encodeCarryLast + letter), {toSkip}, move::right};
+        });
+        addEncoder(transitions, state::encodeCarry, state::encodeWrite,
+                   letter, state::encodeClose);
+        addEncoder(transitions, state::encodeCarryLast,
+                   state::encodeWriteLast, letter,
+                   p(state::encodeFinish + p("0")));
+    }
+    transitions[{state::encodeSeekEnd, {BLANK}}] = {
+        state::encodeOpen, {leftGuard}, move::right};
+    transitions[{state::encodeOpen, {BLANK}}] = {
+        state::encodeSeekInput, {rightGuard}, move::left};
+    std::ranges::for_each(encoded, [&](const auto &toSkip) {
+        transitions[{state::encodeSeekInput, {toSkip}}] = {
+            state::encodeSeekInput, {toSkip}, move::left};
+    });
+
+    // leave the indicator blank and move the right guard
+    transitions[{state::encodeClose, {BLANK}}] = {
+        p(state::encodeClose + "1"), {BLANK}, move::right};
+    transitions[{p(state::encodeClose + "1"), {BLANK}}] = {
+        state::encodeSeekInput, {rightGuard}, move::left};
+
+    // empty word cornercase, a single blank cell
+    transitions[{INITIAL_STATE, {BLANK}}] = {
+        p(state::encodeWriteLast + BLANK + p(std::to_string(width - 1))),
+        {leftGuard},
+        move::right};
+    addEncoder(transitions, "", state::encodeWriteLast, BLANK,
+               p(state::encodeFinish + p("0")));
+
+    // append 1 (Sep) 1 [blank codeword] (RG)
+    std::vector<std::string> finish = {letter::headIndicator, separator,
+                                       letter::headIndicator};
+    finish.insert(finish.end(), width, digits[0]);
+    for (size_t i = 0; i < finish.size(); ++i)
+        transitions[{p(state::encodeFinish + p(std::to_string(i))), {BLANK}}] =
+            {p(state::encodeFinish + p(std::to_string(i + 1))),
+             {finish[i]},
+             move::right};
+    transitions[{p(state::encodeFinish + p(std::to_string(finish.size()))),
+                 {BLANK}}] = {state::seekSeparator, {rightGuard}, move::left};
+
+    // start simulation
+    transitions[{state::seekSeparator, {digits[0]}}] = {
+        state::seekSeparator, {digits[0]}, move::left};
+    transitions[{state::seekSeparator, {letter::headIndicator}}] = {
+        state::seekSeparator, {letter::headIndicator}, move::left};
+    transitions[{state::seekSeparator, {separator}}] = {
+        state::searchFirst, {separator}, move::left};
+    transitions[{state::searchFirst, {letter::headIndicator}}] = {
+        p(state::codeReadFirst + INITIAL_STATE + readPrefix(0, 0)),
+        {letter::headIndicator},
+        move::left};
+
+    return std::move(transitions);
+}
+
+// codeword states reading the first head's letter and carrying it to the
+// second head, also shifting the tape when the first head reaches the left
+// guard
+transitions_t &&addCodewordFetchers(transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    const auto toSkipAll = without(extAlphabet, letter::headIndicator);
+    const size_t letters = letterOf.size();
+    for (const auto &state : originalStates) {
+        // halting states are never carried to the first head
+        if (state == ACCEPTING_STATE || state == REJECTING_STATE) continue;
+
+        // read the digits going left from the indicator, then go back to it
+        for (size_t read = 0; read < width; ++read)
+            for (size_t value = 0; value < std::min(powers[read], letters);
+                 ++value)
+                for (size_t digit = 0; digit < digits.size(); ++digit) {
+                    size_t code = value + digit * powers[read];
+                    if (code >= letters) continue;
+                    transitions[{p(state::codeReadFirst + state +
+                                   readPrefix(read, value)),
+                                 {digits[digit]}}] =
+                        read + 1 < width
+                            ? std::make_tuple(p(state::codeReadFirst + state +
+                                                readPrefix(read + 1, code)),
+                                              std::vector{digits[digit]},
+                                              move::left)
+                            : std::make_tuple(
+                                  p(state::codeReturnFirst + state +
+                                    letterOf[code]),
+                                  std::vector{digits[digit]}, move::right);
+                }
+
+        // read the digits going right towards the indicator, the most
+        // significant digit first
+        for (size_t read = 0; read < width; ++read) {
+            size_t step = powers[width - read];
+            for (size_t value = 0; value < letters; value += step)
+                for (size_t digit = 0; digit < digits.size(); ++digit) {
+                    size_t code = value + digit * powers[width - read - 1];
+                    if (code >= letters) continue;
+                    transitions[{p(state::codeReadRight + state +
+                                   readPrefix(read, value)),
+                                 {digits[digit]}}] =
+                        read + 1 < width
+                            ? std::make_tuple(p(state::codeReadRight + state +
+                                                readPrefix(read + 1, code)),
+                                              std::vector{digits[digit]},
+                                              move::right)
+                            : std::make_tuple(
+                                  p(state::codeCarryFirst + state +
+                                    letterOf[code]),
+                                  std::vector{digits[digit]}, move::right);
+                }
+        }
+        // the first head left the 0-th cell
+        transitions[{p(state::codeReadRight + state + readPrefix(0, 0)),
+                     {separator}}] = {state::die, {separator}, move::left};
+
+        for (const auto &letter : letterOf) {
+            std::ranges::for_each(digits, [&](const auto &toSkip) {
+                transitions[{p(state::codeReturnFirst + state + letter),
+                             {toSkip}}] = {
+                    p(state::codeReturnFirst + state + letter),
+                    {toSkip},
+                    move::right};
+            });
+            transitions[{p(state::codeReturnFirst + state + letter),
+                         {letter::headIndicator}}] = {
+                p(state::codeSearchSecond + state + letter),
+                {letter::headIndicator},
+                move::right};
+            transitions[{p(state::codeCarryFirst + state + letter), {BLANK}}] =
+                {p(state::codeSearchSecond + state + letter),
+                 {letter::headIndicator},
+                 move::right};
+
+            // skip everything along the way during search
+            std::ranges::for_each(toSkipAll, [&](const auto &toSkip) {
+                transitions[{p(state::codeSearchSecond + state + letter),
+                             {toSkip}}] = {
+                    p(state::codeSearchSecond + state + letter),
+                    {toSkip},
+                    move::right};
+            });
+            transitions[{p(state::codeSearchSecond + state + letter),
+                         {letter::headIndicator}}] = {
+                p(state::codeReadSecond + state + letter + readPrefix(0, 0)),
+                {letter::headIndicator},
+                move::right};
+        }
+
+        // going right is going left on the virtual first tape
+        transitions[{p(state::codePlaceFirst + state), {BLANK}}] = {
+            p(state::codeReadFirst + state + readPrefix(0, 0)),
+            {letter::headIndicator},
+            move::left};
+        transitions[{p(state::codePlaceFirst + state), {leftGuard}}] = {
+            p(state::codeShift + state + p("1") + letter::headIndicator),
+            {leftGuard},
+            move::right};
+
+        // going left, the next letter is read on the way to the indicator
+        std::ranges::for_each(digits, [&](const auto &toSkip) {
+            transitions[{p(state::codePassFirst + state), {toSkip}}] = {
+                p(state::codePassFirst + state), {toSkip}, move::right};
+        });
+        transitions[{p(state::codePassFirst + state), {BLANK}}] = {
+            p(state::codeReadRight + state + readPrefix(0, 0)),
+            {BLANK},
+            move::right};
+
+        // the tape is shifted right one cell at a time, inserting the
+        // indicator and then the blank codeword after the left guard
+        std::vector<std::string> shifted = extAlphabet;
+        std::erase(shifted, leftGuard);
+        for (size_t pass = 1; pass <= width + 1; ++pass) {
+            const std::string shift =
+                state::codeShift + state + p(std::to_string(pass));
+            for (const auto &carried : shifted) {
+                if (carried == rightGuard) continue;
+                std::ranges::for_each(shifted, [&](const auto &current) {
+                    transitions[{p(shift + carried), {current}}] = {
+                        p(shift + current), {carried}, move::right};
+                });
+            }
+            transitions[{p(shift + rightGuard), {BLANK}}] = {
+                pass <= width ? p(state::codeShiftBack + state +
+                                  p(std::to_string(pass + 1)))
+                              : p(state::codeAfterShift + state),
+                {rightGuard},
+                move::left};
+
+            if (pass == 1) continue;
+            const std::string back =
+                p(state::codeShiftBack + state + p(std::to_string(pass)));
+            std::ranges::for_each(shifted, [&](const auto &toSkip) {
+                transitions[{back, {toSkip}}] = {back, {toSkip}, move::left};
+            });
+            transitions[{back, {leftGuard}}] = {
+                p(shift + digits[0]), {leftGuard}, move::right};
+        }
+
+        // search for the second head, the new first letter is blank
+        std::ranges::for_each(toSkipAll, [&](const auto &toSkip) {
+            transitions[{p(state::codeAfterShift + state), {toSkip}}] = {
+                p(state::codeAfterShift + state), {toSkip}, move::left};
+        });
+        transitions[{p(state::codeAfterShift + state),
+                     {letter::headIndicator}}] = {
+            p(state::codeReadSecond + state + BLANK + readPrefix(0, 0)),
+            {letter::headIndicator},
+            move::right};
+    }
+
+    return std::move(transitions);
+}
+
+// codeword simulator states, as in the fused protocol the whole transition is
+// known at the second head and the first head's update is carried back
+transitions_t &&addCodewordMutators(const TuringMachine &tm,
+                                    transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    const auto toSkipAll = without(extAlphabet, letter::headIndicator);
+    // pending update -> (new state, new letter, direction) on the first tape
+    std::map<std::string, std::tuple<std::string, std::string, char>> pendings;
+    // pending update + new second letter + direction on the second tape
+    std::set<std::tuple<std::string, std::string, char>> secondWrites;
+    // codeword prefixes read at the second head, transitions reading letters
+    // with a common prefix share its reads
+    std::set<std::tuple<std::string, size_t, size_t>> prefixes;
+    for (const auto &[from, to] : tm.transitions) {
+        const auto &[state, letters] = from;
+        const auto &[newState, newLetters, moves] = to;
+        const std::string read = state::codeReadSecond + state + letters[0];
+
+        // only the prefixes of codewords that have a transition are read
+        const size_t code = codeOf[letters[1]];
+        for (size_t position = 0; position + 1 < width; ++position)
+            prefixes.insert({read, position, code % powers[position + 1]});
+
+        const std::pair<std::string, std::vector<std::string>> last = {
+            p(read + readPrefix(width - 1, code % powers[width - 1])),
+            {digitOf(code, width - 1)}};
+        // reject rejecting states, no need to go back to the first head
+        if (newState == REJECTING_STATE) {
+            transitions[last] = {
+                REJECTING_STATE, {digitOf(code, width - 1)}, move::stay};
+            continue;
+        }
+        const std::string pend = pending(newState, newLetters[0], moves[0]);
+        pendings[pend] = {newState, newLetters[0], moves[0]};
+        secondWrites.insert({pend, newLetters[1], moves[1]});
+
+        // the new codeword is written going back to the indicator
+        const size_t newCode = codeOf[newLetters[1]];
+        transitions[last] = {
+            width > 1 ? p(state::codeWriteSecond + pend + newLetters[1] +
+                          move::id(moves[1]) + p(std::to_string(width - 2)))
+                      : p(state::codeMoveSecond + pend + move::id(moves[1])),
+            {digitOf(newCode, width - 1)},
+            move::left};
+    }
+
+    for (const auto &[read, position, value] : prefixes)
+        transitions[{p(read + readPrefix(position, value % powers[position])),
+                     {digitOf(value, position)}}] = {
+            p(read + readPrefix(position + 1, value)),
+            {digitOf(value, position)},
+            move::right};
+
+    std::set<std::pair<std::string, char>> secondMoves;
+    for (const auto &[pend, newLetter, mv] : secondWrites) {
+        secondMoves.insert({pend, mv});
+        const std::string write =
+            state::codeWriteSecond + pend + newLetter + move::id(mv);
+        for (size_t position = 0; position + 1 < width; ++position)
+            std::ranges::for_each(digits, [&](const auto &current) {
+                transitions[{p(write + p(std::to_string(position))),
+                             {current}}] = {
+                    position > 0
+                        ? p(write + p(std::to_string(position - 1)))
+                        : p(state::codeMoveSecond + pend + move::id(mv)),
+                    {digitOf(codeOf[newLetter], position)},
+                    move::left};
+            });
+    }
+
+    for (const auto &[pend, mv] : secondMoves) {
+        const std::pair<std::string, std::vector<std::string>> found = {
+            p(state::codeMoveSecond + pend + move::id(mv)),
+            {letter::headIndicator}};
+        const std::string search = p(state::codeSearchPending + pend);
+
+        // direction stay, skip the second head's indicator
+        if (mv == HEAD_STAY) {
+            transitions[found] = {search, {letter::headIndicator}, move::left};
+            continue;
+        }
+
+        // direction left, erase the indicator and place it one codeword
+        // earlier
+        if (mv == HEAD_LEFT) {
+            const std::string skip = p(state::codeSkipLeft + pend);
+            transitions[found] = {skip, {BLANK}, move::left};
+            std::ranges::for_each(digits, [&](const auto &toSkip) {
+                transitions[{skip, {toSkip}}] = {skip, {toSkip}, move::left};
+            });
+            transitions[{skip, {separator}}] = {
+                state::die, {separator}, move::left};
+            transitions[{skip, {BLANK}}] = {
+                search, {letter::headIndicator}, move::left};
+            continue;
+        }
+
+        // direction right, erase the indicator and place it one codeword
+        // later, the tape is resized at the right guard
+        const std::string skip = p(state::codeSkipRight + pend);
+        transitions[found] = {skip, {BLANK}, move::right};
+        std::ranges::for_each(digits, [&](const auto &toSkip) {
+            transitions[{skip, {toSkip}}] = {skip, {toSkip}, move::right};
+        });
+        transitions[{skip, {BLANK}}] = {
+            search, {letter::headIndicator}, move::left};
+        transitions[{skip, {rightGuard}}] = {
+            p(state::codeResize + pend + p("1")),
+            {letter::headIndicator},
+            move::right};
+        for (size_t position = 1; position <= width; ++position)
+            transitions[{p(state::codeResize + pend +
+                           p(std::to_string(position))),
+                         {BLANK}}] = {
+                p(state::codeResize + pend + p(std::to_string(position + 1))),
+                {digits[0]},
+                move::right};
+        transitions[{p(state::codeResize + pend +
+                       p(std::to_string(width + 1))),
+                     {BLANK}}] = {
+            p(state::codeAfterResize + pend), {rightGuard}, move::left};
+        transitions[{p(state::codeAfterResize + pend), {digits[0]}}] = {
+            p(state::codeAfterResize + pend), {digits[0]}, move::left};
+        transitions[{p(state::codeAfterResize + pend),
+                     {letter::headIndicator}}] = {
+            search, {letter::headIndicator}, move::left};
+    }
+
+    // found the first head, apply the pending update
+    for (const auto &[pend, update] : pendings) {
+        const auto &[newState, newLetter, mv] = update;
+        const std::string search = p(state::codeSearchPending + pend);
+
+        // skip everything along the way searching the left indicator
+        std::ranges::for_each(toSkipAll, [&](const auto &toSkip) {
+            transitions[{search, {toSkip}}] = {search, {toSkip}, move::left};
+        });
+
+        // accept accepting states
+        if (newState == ACCEPTING_STATE) {
+            transitions[{search, {letter::headIndicator}}] = {
+                p(state::checkFall + move::id(mv)),
+                {letter::headIndicator},
+                move::stay};
+            continue;
+        }
+        const std::string write = state::codeWriteFirst + pend;
+        transitions[{search, {letter::headIndicator}}] = {
+            p(write + p("0")),
+            {mv == HEAD_STAY ? letter::headIndicator : BLANK},
+            move::left};
+
+        // after the last digit: direction stay, the new letter is already
+        // known; direction right, the indicator is placed next to the digits;
+        // direction left, the next letter is read on the way to the indicator
+        const auto done =
+            mv == HEAD_STAY
+                ? std::make_tuple(p(state::codeReturnFirst + newState +
+                                    newLetter),
+                                  move::right)
+            : mv == HEAD_RIGHT
+                ? std::make_tuple(p(state::codePlaceFirst + newState),
+                                  move::left)
+                : std::make_tuple(p(state::codePassFirst + newState),
+                                  move::right);
+        for (size_t position = 0; position < width; ++position)
+            std::ranges::for_each(digits, [&](const auto &current) {
+                transitions[{p(write + p(std::to_string(position))),
+                             {current}}] = {
+                    position + 1 < width
+                        ? p(write + p(std::to_string(position + 1)))
+                        : std::get<0>(done),
+                    {digitOf(codeOf[newLetter], position)},
+                    position + 1 < width ? move::left : std::get<1>(done)};
+            });
+    }
+
+    return std::move(transitions);
+}
+
+// the first virtual tape is kept where the input is, in the same orientation,
+// and the heads are marked in the letters under them instead of the indicator
+// cells; falling off the first tape is falling off the actual tape
+void prepareMarks() {
+    std::string longest = *std::ranges::max_element(
+        alphabet,
+        [](std::string a, std::string b) { return a.size() < b.size(); });
+    marked.clear();
+    for (const auto &letter : alphabet)
+        marked[letter] = p(letter::headMarkIndicator + letter + longest);
+
+    // tape letters of the simulation
+    extAlphabet = alphabet;
+    for (const auto &letter : alphabet) extAlphabet.push_back(marked[letter]);
+    extAlphabet.push_back(separator);
+    extAlphabet.push_back(rightGuard);
+}
+
+// creates the tape of the in-place conversion in a single pass, only the first
+// letter gets marked and the second tape is appended:
+// input (Sep) marked blank (RG)
+transitions_t &&addInPlacePreparators(const TuringMachine &tm,
+                                      transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    for (const auto &letter : tm.input_alphabet) {
+        transitions[{INITIAL_STATE, {letter}}] = {
+            state::markSeekEnd, {marked[letter]}, move::right};
+        transitions[{state::markSeekEnd, {letter}}] = {
+            state::markSeekEnd, {letter}, move::right};
+        transitions[{state::markSeekFirst, {letter}}] = {
+            state::markSeekFirst, {letter}, move::left};
+    }
+    // empty word cornercase, a single blank cell
+    transitions[{INITIAL_STATE, {BLANK}}] = {
+        state::markSeekEnd, {marked[BLANK]}, move::right};
+
+    transitions[{state::markSeekEnd, {BLANK}}] = {
+        state::markPlaceSecond, {separator}, move::right};
+    transitions[{state::markPlaceSecond, {BLANK}}] = {
+        state::markPlaceGuard, {marked[BLANK]}, move::right};
+    transitions[{state::markPlaceGuard, {BLANK}}] = {
+        state::markSkipSecond, {rightGuard}, move::left};
+    transitions[{state::markSkipSecond, {marked[BLANK]}}] = {
+        state::markSkipSecond, {marked[BLANK]}, move::left};
+    transitions[{state::markSkipSecond, {separator}}] = {
+        state::markSeekFirst, {separator}, move::left};
+
+    // start simulation
+    std::vector<std::string> first = tm.input_alphabet;
+    first.push_back(BLANK);
+    for (const auto &letter : first)
+        transitions[{state::markSeekFirst, {marked[letter]}}] = {
+            p(state::markSearchSecond + INITIAL_STATE + letter),
+            {marked[letter]},
+            move::right};
+
+    return std::move(transitions);
+}
+
+// in-place simulator states, as in the fused protocol the first head's update
+// is carried back from the second head in the state
+transitions_t &&addInPlaceMutators(const TuringMachine &tm,
+                                   transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    std::vector<std::string> unmarkedSep = alphabet;
+    unmarkedSep.push_back(separator);
+
+    for (const auto &state : originalStates) {
+        // halting states are never carried to the second head
+        if (state == ACCEPTING_STATE || state == REJECTING_STATE) continue;
+
+        // skip everything along the way during search
+        for (const auto &letter : alphabet)
+            std::ranges::for_each(unmarkedSep, [&](const auto &toSkip) {
+                transitions[{p(state::markSearchSecond + state + letter),
+                             {toSkip}}] = {
+                    p(state::markSearchSecond + state + letter),
+                    {toSkip},
+                    move::right};
+            });
+
+        // mark the first head's new cell and carry its letter
+        for (const auto &letter : alphabet) {
+            transitions[{p(state::markRightFirst + state), {letter}}] = {
+                p(state::markSearchSecond + state + letter),
+                {marked[letter]},
+                move::right};
+            transitions[{p(state::markLeftFirst + state), {letter}}] = {
+                p(state::markSearchSecond + state + letter),
+                {marked[letter]},
+                move::right};
+        }
+
+        // the first tape grows into the separator, which is shifted right
+        // together with the second tape
+        transitions[{p(state::markRightFirst + state), {separator}}] = {
+            p(state::markShift + state + separator),
+            {marked[BLANK]},
+            move::right};
+        std::vector<std::string> shifted = extAlphabet;
+        std::erase(shifted, separator);
+        for (const auto &carried : extAlphabet) {
+            if (carried == rightGuard) continue;
+            std::ranges::for_each(shifted, [&](const auto &current) {
+                transitions[{p(state::markShift + state + carried),
+                             {current}}] = {
+                    p(state::markShift + state + current),
+                    {carried},
+                    move::right};
+            });
+        }
+        transitions[{p(state::markShift + state + rightGuard), {BLANK}}] = {
+            p(state::markAfterShift + state), {rightGuard}, move::left};
+
+        // search for the second head, the new first letter is blank
+        for (const auto &letter : alphabet) {
+            transitions[{p(state::markAfterShift + state), {letter}}] = {
+                p(state::markAfterShift + state), {letter}, move::left};
+            transitions[{p(state::markAfterShift + state), {marked[letter]}}] =
+                {p(state::markSearchSecond + state + BLANK),
+                 {marked[letter]},
+                 move::stay};
+        }
+    }
+
+    // pending update -> (new state, new letter, direction) on the first tape
+    std::map<std::string, std::tuple<std::string, std::string, char>> pendings;
+    std::set<std::pair<std::string, char>> secondMoves;
+    for (const auto &[from, to] : tm.transitions) {
+        const auto &[state, letters] = from;
+        const auto &[newState, newLetters, moves] = to;
+        const std::pair<std::string, std::vector<std::string>> found = {
+            p(state::markSearchSecond + state + letters[0]),
+            {marked[letters[1]]}};
+        // reject rejecting states, no need to go back to the first head
+        if (newState == REJECTING_STATE) {
+            transitions[found] = {
+                REJECTING_STATE, {marked[letters[1]]}, move::stay};
+            continue;
+        }
+        const std::string pend = pending(newState, newLetters[0], moves[0]);
+        pendings[pend] = {newState, newLetters[0], moves[0]};
+        secondMoves.insert({pend, moves[1]});
+
+        // mutate the second head right away
+        if (moves[1] == HEAD_STAY)
+            transitions[found] = {p(state::markSearchPending + pend),
+                                  {marked[newLetters[1]]},
+                                  move::left};
+        else if (moves[1] == HEAD_RIGHT)
+            transitions[found] = {p(state::markRightSecond + pend),
+                                  {newLetters[1]},
+                                  move::right};
+        else
+            transitions[found] = {
+                p(state::markLeftSecond + pend), {newLetters[1]}, move::left};
+    }
+
+    for (const auto &[pend, mv] : secondMoves) {
+        const std::string search = p(state::markSearchPending + pend);
+        // direction left, mark the previous letter unless it is the separator
+        if (mv == HEAD_LEFT) {
+            for (const auto &letter : alphabet)
+                transitions[{p(state::markLeftSecond + pend), {letter}}] = {
+                    search, {marked[letter]}, move::left};
+            transitions[{p(state::markLeftSecond + pend), {separator}}] = {
+                state::die, {separator}, move::left};
+        }
+        // direction right, mark the next letter, the tape is resized at the
+        // right guard
+        if (mv == HEAD_RIGHT) {
+            for (const auto &letter : alphabet)
+                transitions[{p(state::markRightSecond + pend), {letter}}] = {
+                    search, {marked[letter]}, move::left};
+            transitions[{p(state::markRightSecond + pend), {rightGuard}}] = {
+                p(state::markResizeSecond + pend),
+                {marked[BLANK]},
+                move::right};
+            transitions[{p(state::markResizeSecond + pend), {BLANK}}] = {
+                p(state::markAfterResize + pend), {rightGuard}, move::left};
+            transitions[{p(state::markAfterResize + pend), {marked[BLANK]}}] =
+                {search, {marked[BLANK]}, move::left};
+        }
+    }
+
+    // found the first head, apply the pending update
+    for (const auto &[pend, update] : pendings) {
+        const auto &[newState, newLetter, mv] = update;
+        const std::string search = p(state::markSearchPending + pend);
+
+        // skip everything along the way searching the left mark
+        std::ranges::for_each(unmarkedSep, [&](const auto &toSkip) {
+            transitions[{search, {toSkip}}] = {search, {toSkip}, move::left};
+        });
+
+        for (const auto &letter : alphabet) {
+            const std::pair<std::string, std::vector<std::string>> found = {
+                search, {marked[letter]}};
+            // accept accepting states, unless the first head falls off
+            if (newState == ACCEPTING_STATE)
+                transitions[found] =
+                    mv == HEAD_LEFT
+                        ? std::make_tuple(state::markCheckFall,
+                                          std::vector{marked[letter]},
+                                          move::left)
+                        : std::make_tuple(std::string(ACCEPTING_STATE),
+                                          std::vector{marked[letter]},
+                                          move::stay);
+            // direction stay, the new letter is already known
+            else if (mv == HEAD_STAY)
+                transitions[found] = {
+                    p(state::markSearchSecond + newState + newLetter),
+                    {marked[newLetter]},
+                    move::right};
+            else if (mv == HEAD_RIGHT)
+                transitions[found] = {p(state::markRightFirst + newState),
+                                      {newLetter},
+                                      move::right};
+            // direction left, on the 0-th cell the machine falls off the tape
+            else
+                transitions[found] = {p(state::markLeftFirst + newState),
+                                      {newLetter},
+                                      move::left};
+        }
+    }
+    for (const auto &letter : alphabet)
+        transitions[{state::markCheckFall, {letter}}] = {
+            ACCEPTING_STATE, {letter}, move::stay};
+
+    return std::move(transitions);
+}
+
+// block speedup only, letters are blocks of blockSize cells of the original
+// machine, the block of blanks is the blank itself
+size_t blockSize;
+std::string blockSuffix;
+std::string vacated;
+std::string vacatedFirst;
+
+std::string concat(const std::vector<std::string> &cells) {
+    std::string res;
+    for (const auto &cell : cells) res += cell;
+    return res;
+}
+
+std::string blockName(const std::vector<std::string> &cells) {
+    if (std::ranges::all_of(cells, [](const auto &c) { return c == BLANK; }))
+        return BLANK;
+    return p(letter::blockIndicator + concat(cells) + blockSuffix);
+}
+
+// the block at the 0-th cell while the input is gathered
+std::string firstBlockName(const std::vector<std::string> &cells) {
+    return p(letter::firstBlockIndicator + concat(cells) + blockSuffix);
+}
+
+// original state with the offsets of the heads within their blocks
+std::string blockState(const std::string &original,
+                       const std::vector<size_t> &offsets) {
+    std::string res = state::blockStep + original;
+    for (const auto offset : offsets) res += p(std::to_string(offset));
+    return p(res);
+}
+
+// the letter on the first tape and blanks on the others, which stay
+std::vector<std::string> onFirst(const TuringMachine &tm,
+                                 const std::string &letter) {
+    std::vector<std::string> letters(tm.num_tapes, BLANK);
+    letters[0] = letter;
+    return letters;
+}
+
+std::string moveFirst(const TuringMachine &tm, const std::string &mv) {
+    return mv + std::string(tm.num_tapes - 1, HEAD_STAY);
+}
+
+// every block the input can be gathered into, the last one padded with blanks
+std::vector<std::vector<std::string>> inputBlocks(const TuringMachine &tm) {
+    std::vector<std::vector<std::string>> blocks = {{}};
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (blocks[i].size() == blockSize) continue;
+        for (const auto &letter : tm.input_alphabet) {
+            blocks.push_back(blocks[i]);
+            blocks.back().push_back(letter);
+        }
+    }
+    blocks.erase(blocks.begin());
+    for (auto &block : blocks) block.resize(blockSize, BLANK);
+    return blocks;
+}
+
+// gathers the input into blocks from the left, the cells left behind are
+// vacated and erased once the input ends, then the head returns to the first
+// block, which is marked until then:
+// B B .. B (vacated) .. (vacated) input _ -> B .. B _
+transitions_t &&addBlockPreparators(const TuringMachine &tm,
+                                    transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    const std::string start =
+        blockState(INITIAL_STATE, std::vector<size_t>(tm.num_tapes, 0));
+    const auto blocks = inputBlocks(tm);
+
+    // empty word cornercase, the tape is already the blank block
+    transitions[{INITIAL_STATE, onFirst(tm, BLANK)}] = {
+        start, onFirst(tm, BLANK), moveFirst(tm, move::stay)};
+    for (const auto &letter : tm.input_alphabet) {
+        transitions[{INITIAL_STATE, onFirst(tm, letter)}] = {
+            p(state::blockGather + letter), onFirst(tm, vacatedFirst),
+            moveFirst(tm, move::right)};
+        transitions[{state::blockSkip, onFirst(tm, letter)}] = {
+            p(state::blockGather + letter), onFirst(tm, vacated),
+            moveFirst(tm, move::right)};
+    }
+
+    for (const auto &block : blocks) {
+        // gathering, the letters read so far are carried in the state
+        const size_t read = block.size() - std::ranges::count(block, BLANK);
+        const std::vector<std::string> prefix(block.begin(),
+                                              block.begin() + read);
+        const std::string gather = p(state::blockGather + concat(prefix));
+        if (read < blockSize) {
+            // the input ends inside the block
+            transitions[{gather, onFirst(tm, BLANK)}] = {
+                p(state::blockCarryLast + blockName(block)),
+                onFirst(tm, BLANK), moveFirst(tm, move::left)};
+            for (const auto &letter : tm.input_alphabet) {
+                std::vector<std::string> next = prefix;
+                next.push_back(letter);
+                transitions[{gather, onFirst(tm, letter)}] = {
+                    next.size() == blockSize
+                        ? p(state::blockCarry + blockName(next))
+                        : p(state::blockGather + concat(next)),
+                    onFirst(tm, vacated),
+                    moveFirst(tm, next.size() == blockSize ? move::left
+                                                           : move::right)};
+            }
+        }
+
+        // carrying the block left, the last block erases the vacated cells
+        {
+            const bool last = read < blockSize;
+            const std::string carry =
+                p((last ? state::blockCarryLast : state::blockCarry) +
+                  blockName(block));
+            const std::string write =
+                p((last ? state::blockWriteLast : state::blockWrite) +
+                  blockName(block));
+            transitions[{carry, onFirst(tm, vacated)}] = {
+                carry, onFirst(tm, last ? BLANK : vacated),
+                moveFirst(tm, move::left)};
+            transitions[{carry, onFirst(tm, vacatedFirst)}] =
+                last ? std::make_tuple(start, onFirst(tm, blockName(block)),
+                                       moveFirst(tm, move::stay))
+                     : std::make_tuple(std::string(state::blockSkip),
+                                       onFirst(tm, firstBlockName(block)),
+                                       moveFirst(tm, move::right));
+            for (const auto &placed : blocks)
+                for (const auto &name :
+                     {blockName(placed), firstBlockName(placed)})
+                    transitions[{carry, onFirst(tm, name)}] = {
+                        write, onFirst(tm, name), moveFirst(tm, move::right)};
+            transitions[{write, onFirst(tm, last ? BLANK : vacated)}] = {
+                last ? state::blockReturn : state::blockSkip,
+                onFirst(tm, blockName(block)),
+                moveFirst(tm, last ? move::left : move::right)};
+        }
+
+        // back to the first block
+        for (const auto &back : {state::blockErase, state::blockReturn}) {
+            transitions[{back, onFirst(tm, blockName(block))}] = {
+                state::blockReturn, onFirst(tm, blockName(block)),
+                moveFirst(tm, move::left)};
+            transitions[{back, onFirst(tm, firstBlockName(block))}] = {
+                start, onFirst(tm, blockName(block)),
+                moveFirst(tm, move::stay)};
+        }
+    }
+
+    // the input ends on the border of a block
+    transitions[{state::blockSkip, onFirst(tm, vacated)}] = {
+        state::blockSkip, onFirst(tm, vacated), moveFirst(tm, move::right)};
+    transitions[{state::blockSkip, onFirst(tm, BLANK)}] = {
+        state::blockErase, onFirst(tm, BLANK), moveFirst(tm, move::left)};
+    transitions[{state::blockErase, onFirst(tm, vacated)}] = {
+        state::blockErase, onFirst(tm, BLANK), moveFirst(tm, move::left)};
+
+    return std::move(transitions);
+}
+
+// a single step of the block machine, the original machine is run on the
+// blocks under the heads until a head leaves its block or it halts; a run that
+// never leaves the blocks becomes a transition to itself
+transitions_t &&addBlockSteps(const TuringMachine &tm,
+                              transitions_t &&transitions) {
+    const CountWrites counting(__func__);
+    typedef std::vector<std::vector<std::string>> cells_t;
+    const size_t tapes = tm.num_tapes;
+
+    // blocks that can be under the heads of every tape and the states with
+    // offsets the steps start from, both grow until nothing new is found
+    std::vector<cells_t> known(tapes, {std::vector<std::string>(blockSize,
+                                                                BLANK)});
+    std::vector<std::set<std::vector<std::string>>> knownSet(tapes);
+    knownSet[0].insert(known[0][0]);
+    for (size_t tape = 1; tape < tapes; ++tape)
+        knownSet[tape].insert(known[tape][0]);
+    for (const auto &block : inputBlocks(tm))
+        if (knownSet[0].insert(block).second) known[0].push_back(block);
+    std::vector<std::pair<std::string, std::vector<size_t>>> starts = {
+        {INITIAL_STATE, std::vector<size_t>(tapes, 0)}};
+    std::set<std::pair<std::string, std::vector<size_t>>> startSet(
+        starts.begin(), starts.end());
+
+    auto names = [&](const cells_t &cells) {
+        std::vector<std::string> res;
+        for (const auto &block : cells) res.push_back(blockName(block));
+        return res;
+    };
+
+    // runs the original machine, false if it has no transition at all
+    auto step = [&](const std::string &from, const std::vector<size_t> &start,
+                    const cells_t &read) {
+        const std::pair<std::string, std::vector<std::string>> key = {
+            blockState(from, start), names(read)};
+        std::set<std::tuple<std::string, std::vector<size_t>, cells_t>> seen;
+        std::string state = from;
+        std::vector<size_t> offsets = start;
+        cells_t cells = read;
+        std::vector<std::string> under(tapes);
+        for (size_t steps = 0;; ++steps) {
+            for (size_t tape = 0; tape < tapes; ++tape)
+                under[tape] = cells[tape][offsets[tape]];
+            auto it = tm.transitions.find({state, under});
+            if (it == tm.transitions.end() ||
+                std::get<0>(it->second) == REJECTING_STATE) {
+                // no transition means rejection, also before the first step
+                if (steps > 0)
+                    transitions[key] = {REJECTING_STATE, key.second,
+                                        std::string(tapes, HEAD_STAY)};
+                return;
+            }
+            const auto &[next, written, directions] = it->second;
+            std::string moves(tapes, HEAD_STAY);
+            for (size_t tape = 0; tape < tapes; ++tape) {
+                cells[tape][offsets[tape]] = written[tape];
+                if (directions[tape] == HEAD_LEFT && offsets[tape]-- == 0) {
+                    moves[tape] = HEAD_LEFT;
+                    offsets[tape] = blockSize - 1;
+                } else if (directions[tape] == HEAD_RIGHT &&
+                           ++offsets[tape] == blockSize) {
+                    moves[tape] = HEAD_RIGHT;
+                    offsets[tape] = 0;
+                }
+            }
+            state = next;
+
+            // a head left its block or the machine accepts, as usual after
+            // the moves
+            if (state == ACCEPTING_STATE ||
+                moves != std::string(tapes, HEAD_STAY)) {
+                transitions[key] = {state == ACCEPTING_STATE
+                                        ? state
+                                        : blockState(state, offsets),
+                                    names(cells), moves};
+                for (size_t tape = 0; tape < tapes; ++tape)
+                    if (knownSet[tape].insert(cells[tape]).second)
+                        known[tape].push_back(cells[tape]);
+                if (state != ACCEPTING_STATE &&
+                    startSet.insert({state, offsets}).second)
+                    starts.emplace_back(state, offsets);
+                return;
+            }
+            if (!seen.emplace(state, offsets, cells).second) {
+                transitions[key] = {key.first, key.second,
+                                    std::string(tapes, HEAD_STAY)};
+                return;
+            }
+        }
+    };
+
+    // every combination of known blocks for every start, until the sets stop
+    // growing; the combinations done for a start are those below the numbers
+    // of known blocks at its last pass, so they take no memory per transition
+    std::vector<std::vector<size_t>> done;
+    auto isDone = [&](const std::vector<size_t> &choice) {
+        for (size_t tape = 0; tape < tapes; ++tape)
+            if (choice[tape + 1] >= done[choice[0]][tape]) return false;
+        return true;
+    };
+    for (bool grown = true; grown;) {
+        grown = false;
+        for (size_t s = 0; s < starts.size(); ++s) {
+            std::vector<size_t> sizes;
+            for (const auto &blocks : known) sizes.push_back(blocks.size());
+            done.resize(starts.size(), std::vector<size_t>(tapes, 0));
+            std::vector<size_t> choice(tapes + 1, 0);
+            choice[0] = s;
+            for (;;) {
+                if (!isDone(choice)) {
+                    grown = true;
+                    cells_t read;
+                    for (size_t tape = 0; tape < tapes; ++tape)
+                        read.push_back(known[tape][choice[tape + 1]]);
+                    step(starts[s].first, starts[s].second, read);
+                }
+                size_t tape = 0;
+                for (; tape < tapes; ++tape) {
+                    if (++choice[tape + 1] < sizes[tape]) break;
+                    choice[tape + 1] = 0;
+                }
+                if (tape == tapes) break;
+            }
+            done[s] = sizes;
+        }
+    }
+
+    return std::move(transitions);
+}
+
 }  // namespace
 
-void TuringMachine::twoToOne() {
+void TuringMachine::twoToOne(const ConversionOptions &options,
+                            TransitionRuns *external) {
     this->num_tapes = 1;
 
     prepareGlobals(*this);
 
-    // make new states
-    this->transitions = addMutators(
-        *this, addSearchersAndFetchers(addSeparatorRejects(
-                   addResizers(addTapePreparators(transitions_t())))));
+    if (options.codewordBase > 0) {
+        prepareCodewords(*this, options.codewordBase);
+        this->transitions = addCodewordMutators(
+            *this,
+            addCodewordFetchers(addFallCheckers(addSeparatorRejects(
+                addCodewordPreparators(*this, transitions_t(external))))));
+        return;
+    }
+    if (options.inPlace) {
+        prepareMarks();
+        this->transitions = addInPlaceMutators(
+            *this, addSeparatorRejects(
+                       addInPlacePreparators(*this, transitions_t(external))));
+        return;
+    }
+
+    // make new states, the steps of the default protocol are predicted in
+    // step_predictor.cpp
+    transitions_t common = addFallCheckers(addFirstFetchers(addSeparatorRejects(
+        addLeftShifters(addTapePreparators(transitions_t(external))))));
+    if (options.fused)
+        this->transitions = addFusedMutators(*this, std::move(common));
+    else
+        this->transitions = addMutators(
+            *this, addSearchersAndFetchers(addRightResizers(
+                       std::move(common), state::mutateSecond,
+                       state::searchFirst, resizeKeys())));
+}
+
+void TuringMachine::toBlocks(size_t size, TransitionRuns *external) {
+    assert(size >= 2);
+    blockSize = size;
+    blockSuffix = longestInputLetter(*this);
+    vacated = p(letter::vacatedIndicator + blockSuffix);
+    vacatedFirst = p(letter::firstVacatedIndicator + blockSuffix);
+
+    this->transitions = addBlockSteps(
+        *this, addBlockPreparators(*this, transitions_t(external)));
+}
+
+transitions_t::Write &transitions_t::Write::operator=(
+    const mapped_type &value) {
+    if (transitions.runs) {
+        transitions.runs->add(key, value, running_generator());
+        return *this;
+    }
+    auto [it, added] = transitions.try_emplace(key, value);
+    count_write(added, !added && it->second != value);
+    if (!added) it->second = value;
+    return *this;
+}
+
+void count_write(bool added, bool changed) {
+    ++counted->writes;
+    if (!added) ++(changed ? counted->conflicting : counted->redundant);
 }
+
+WriteCounts &running_generator() { return *counted; }
+
+const std::map<std::string, WriteCounts> &write_counts() { return counts; }
 //--------------END IMPLEMENTATION-----------------------//
 
 class Reader {
@@ -616,14 +2004,19 @@ class Reader {
         return next_char != '\n' && next_char != EOF;
     }
 
-    string next_token() {  // only in the current line
+    // only in the current line; the token is a part of the input, as a comment
+    // always ends it
+    string_view next_token() {
         assert(is_next_token_available());
-        string res;
+        const char *begin = get_position();
+        size_t length = 0;
         while (next_char != ' ' && next_char != '\t' && next_char != '\n' &&
-               next_char != EOF)
-            res += get_next_char();
+               next_char != EOF) {
+            get_next_char();
+            ++length;
+        }
         skip_spaces();
-        return res;
+        return string_view(begin, length);
     }
 
     void go_to_next_line() {  // in particular skips empty lines
@@ -634,10 +2027,8 @@ class Reader {
         }
     }
 
-    ~Reader() { assert(fclose(input) == 0); }
-
-    Reader(FILE *input_) : input(input_) {
-        assert(input);
+    // reads the characters [begin, end), line numbers start from 1
+    Reader(const char *begin, const char *end) : input(begin), input_end(end) {
         get_next_char();
         skip_spaces();
         if (!is_next_token_available()) go_to_next_line();
@@ -645,18 +2036,25 @@ class Reader {
 
     int get_line_num() const { return line; }
 
+    // position of the next character, one after the end at EOF
+    const char *get_position() const { return input - (next_char != EOF); }
+
    private:
-    FILE *input;
-    int next_char;  // we always have the next char here
+    const char *input, *input_end;
+    int next_char = 0;  // we always have the next char here
     int line = 1;
 
+    int fetch() {
+        return input < input_end ? (unsigned char)*input++ : EOF;
+    }
+
     int get_next_char() {
         if (next_char == '\n') ++line;
         int prev = next_char;
-        next_char = fgetc(input);
+        next_char = fetch();
         if (next_char == '#')  // skip a comment until EOL or EOF
             while (next_char != '\n' && next_char != EOF)
-                next_char = fgetc(input);
+                next_char = fetch();
         return prev;
     }
 
@@ -677,7 +2075,7 @@ static bool is_direction(int ch) {
 // searches for an identifier starting from position pos;
 // at the end pos is the position after the identifier
 // (if false returned, pos remains unchanged)
-static bool check_identifier(string ident, size_t &pos) {
+static bool check_identifier(string_view ident, size_t &pos) {
     if (pos >= ident.size()) return false;
     if (is_valid_char(ident[pos])) {
         ++pos;
@@ -698,66 +2096,325 @@ static bool is_identifier(string ident) {
     return check_identifier(ident, pos) && pos == ident.length();
 }
 
+// the transitions are validated by read_tm_from_file or generated by the
+// conversion, so they are not checked again here
 TuringMachine::TuringMachine(int num_tapes_, vector<string> input_alphabet_,
                              transitions_t transitions_)
     : num_tapes(num_tapes_),
-      input_alphabet(input_alphabet_),
-      transitions(transitions_) {
+      input_alphabet(std::move(input_alphabet_)),
+      transitions(std::move(transitions_)) {
     assert(num_tapes > 0);
     assert(!input_alphabet.empty());
     for (auto letter : input_alphabet)
         assert(is_identifier(letter) && letter != BLANK);
-    for (auto transition : transitions) {
-        auto state_before = transition.first.first;
-        auto letters_before = transition.first.second;
-        auto state_after = get<0>(transition.second);
-        auto letters_after = get<1>(transition.second);
-        auto directions = get<2>(transition.second);
-        assert(is_identifier(state_before) && state_before != ACCEPTING_STATE &&
-               state_before != REJECTING_STATE && is_identifier(state_after));
-        assert(letters_before.size() == (size_t)num_tapes &&
-               letters_after.size() == (size_t)num_tapes &&
-               directions.length() == (size_t)num_tapes);
-        for (int a = 0; a < num_tapes; ++a)
-            assert(is_identifier(letters_before[a]) &&
-                   is_identifier(letters_after[a]) &&
-                   is_direction(directions[a]));
-    }
-}
-
-#define syntax_error(reader, message)                                    \
-    for (;;) {                                                           \
-        cerr << "Syntax error in line " << reader.get_line_num() << ": " \
-             << message << "\n";                                         \
-        exit(1);                                                         \
-    }
-
-static string read_identifier(Reader &reader) {
+}
+
+// line is relative to the beginning of the parsed part of the file
+struct SyntaxError {
+    int line;
+    string message;
+};
+
+#define syntax_error(reader, message)                              \
+    for (;;) {                                                     \
+        ostringstream error_text;                                  \
+        error_text << message;                                     \
+        throw SyntaxError{reader.get_line_num(), error_text.str()}; \
+    }
+
+// a part of the input
+static string_view read_identifier(Reader &reader) {
     if (!reader.is_next_token_available())
         syntax_error(reader, "Identifier expected");
-    string ident = reader.next_token();
+    string_view ident = reader.next_token();
     size_t pos = 0;
     if (!check_identifier(ident, pos) || pos != ident.length())
         syntax_error(reader, "Invalid identifier \"" << ident << "\"");
     return ident;
 }
 
-#define NUM_TAPES "num-tapes:"
-#define INPUT_ALPHABET "input-alphabet:"
+namespace {
 
-TuringMachine read_tm_from_file(FILE *input) {
-    Reader reader(input);
+// transition lines are parsed in chunks of at least this many bytes
+const size_t MIN_CHUNK = 1 << 16;
+
+// transitions of a chunk in the order of lines, the identifiers point into the
+// contents of the file; parsing stops at the first error, the determinism of
+// the chunk is checked only while merging
+struct Chunk {
+    // the line of every transition
+    vector<int> lines;
+    // 2 * (num_tapes + 1) identifiers of every transition: the state and the
+    // letters before, then the state and the letters after
+    vector<string_view> identifiers;
+    // num_tapes moves of every transition
+    string moves;
+    optional<SyntaxError> error;
+    // the error comes after the state and letters before were read, so it
+    // is preceded by the determinism check of the line; the last transition
+    // then has only these identifiers
+    bool error_after_key = false;
+    // number of lines of the chunk
+    int num_lines = 0;
+};
 
-    // number of tapes
+void parse_transition(Reader &reader, int num_tapes, Chunk &chunk,
+                      bool &key_read) {
+    chunk.lines.push_back(reader.get_line_num());
+
+    string_view state_before = read_identifier(reader);
+    if (state_before == "(accept)" || state_before == "(reject)")
+        syntax_error(reader, "No transition can start in the \""
+                                 << state_before << "\" state");
+    chunk.identifiers.push_back(state_before);
+
+    for (int a = 0; a < num_tapes; ++a)
+        chunk.identifiers.push_back(read_identifier(reader));
+    key_read = true;
+
+    // the state and the letters after
+    for (int a = 0; a <= num_tapes; ++a)
+        chunk.identifiers.push_back(read_identifier(reader));
+
+    for (int a = 0; a < num_tapes; ++a) {
+        string_view dir;
+        if (!reader.is_next_token_available() ||
+            (dir = reader.next_token()).length() != 1 || !is_direction(dir[0]))
+            syntax_error(reader, "Move direction expected, which should be "
+                                     << HEAD_LEFT << ", " << HEAD_RIGHT
+                                     << ", or " << HEAD_STAY);
+        chunk.moves += dir[0];
+    }
+
+    if (reader.is_next_token_available())
+        syntax_error(reader, "Too many tokens in a line");
+    reader.go_to_next_line();
+}
+
+void parse_chunk(const char *begin, const char *end, int num_tapes,
+                 Chunk &chunk) {
+    Reader reader(begin, end);
+    while (reader.is_next_token_available()) {
+        size_t parsed = chunk.lines.size();
+        bool key_read = false;
+        try {
+            parse_transition(reader, num_tapes, chunk, key_read);
+        } catch (SyntaxError &error) {
+            chunk.error = std::move(error);
+            chunk.error_after_key = key_read;
+            chunk.lines.resize(parsed + key_read);
+            chunk.identifiers.resize((2 * parsed + key_read) *
+                                     (num_tapes + 1));
+            chunk.moves.resize(parsed * num_tapes);
+            return;
+        }
+    }
+    chunk.num_lines = reader.get_line_num();
+}
+
+// the chunks end right after a newline, except the last one
+vector<pair<const char *, const char *>> split_lines(const char *begin,
+                                                     const char *end,
+                                                     unsigned parts) {
+    size_t size = max<size_t>((end - begin) / max(parts, 1u), MIN_CHUNK);
+    vector<pair<const char *, const char *>> chunks;
+    while (begin != end) {
+        const char *split = end;
+        if ((size_t)(end - begin) > size) {
+            split = find(begin + size, end, '\n');
+            if (split != end) ++split;
+        }
+        chunks.emplace_back(begin, split);
+        begin = split;
+    }
+    return chunks;
+}
+
+// the transition lines are independent once the number of tapes is known,
+// chunks of them are parsed on separate threads; they are merged in order, so
+// the reported error is the one a sequential reader would find first
+vector<Chunk> parse_chunks(const char *begin, const char *end, int num_tapes) {
+    auto ranges = split_lines(begin, end, thread::hardware_concurrency());
+    vector<Chunk> chunks(ranges.size());
+    vector<thread> threads;
+    for (size_t i = 1; i < ranges.size(); ++i)
+        threads.emplace_back(parse_chunk, ranges[i].first, ranges[i].second,
+                             num_tapes, ref(chunks[i]));
+    if (!ranges.empty())
+        parse_chunk(ranges[0].first, ranges[0].second, num_tapes, chunks[0]);
+    for (auto &worker : threads) worker.join();
+    return chunks;
+}
+
+transitions_t read_transitions(const char *begin, const char *end,
+                               int num_tapes, int first_line) {
+    vector<Chunk> chunks = parse_chunks(begin, end, num_tapes);
+    const size_t per_line = 2 * (num_tapes + 1);
+    transitions_t transitions;
+    for (auto &chunk : chunks) {
+        for (size_t i = 0; i < chunk.lines.size(); ++i) {
+            const string_view *ids = &chunk.identifiers[i * per_line];
+            transitions_t::key_type key(
+                ids[0], vector<string>(ids + 1, ids + num_tapes + 1));
+            // the line with the error only takes part in the check
+            bool added =
+                chunk.error_after_key && i + 1 == chunk.lines.size()
+                    ? !transitions.contains(key)
+                    : transitions
+                          .emplace(std::move(key),
+                                   transitions_t::mapped_type(
+                                       ids[num_tapes + 1],
+                                       vector<string>(ids + num_tapes + 2,
+                                                      ids + per_line),
+                                       chunk.moves.substr(i * num_tapes,
+                                                          num_tapes)))
+                          .second;
+            if (!added)
+                throw SyntaxError{first_line + chunk.lines[i] - 1,
+                                  "The machine is not deterministic"};
+        }
+        if (chunk.error) {
+            chunk.error->line += first_line - 1;
+            throw *chunk.error;
+        }
+        first_line += chunk.num_lines - 1;
+    }
+    return transitions;
+}
+
+// identifiers numbered in the order they first appear
+class Numbering {
+   public:
+    uint32_t operator()(string_view name) {
+        auto [it, added] = ids.try_emplace(name, names.size());
+        if (added) names.push_back(name);
+        return it->second;
+    }
+
+    // the identifiers in the sorted order, sorted_id maps the numbers to the
+    // positions in it
+    vector<string> sorted(vector<uint32_t> &sorted_id) const {
+        vector<uint32_t> order(names.size());
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(),
+             [&](uint32_t a, uint32_t b) { return names[a] < names[b]; });
+        sorted_id.resize(names.size());
+        vector<string> result;
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            sorted_id[order[i]] = i;
+            result.emplace_back(names[order[i]]);
+        }
+        return result;
+    }
+
+   private:
+    unordered_map<string_view, uint32_t> ids;
+    vector<string_view> names;
+};
+
+// the determinism is checked once the transitions are sorted: the earliest
+// line repeating a key is the one a sequential reader would report
+template <int N>
+CompactMachine<N> read_compact_transitions(const char *begin, const char *end,
+                                           int first_line,
+                                           vector<string> input_alphabet) {
+    typedef typename CompactMachine<N>::Transition Transition;
+    vector<Chunk> chunks = parse_chunks(begin, end, N);
+    const size_t per_line = 2 * (N + 1);
+
+    Numbering states, letters;
+    // with their lines, up to the first error
+    vector<pair<Transition, int>> read;
+    optional<SyntaxError> error;
+    for (auto &chunk : chunks) {
+        for (size_t i = 0; i < chunk.lines.size(); ++i) {
+            const string_view *ids = &chunk.identifiers[i * per_line];
+            Transition transition{};
+            transition.state = states(ids[0]);
+            for (int a = 0; a < N; ++a)
+                transition.letters[a] = letters(ids[a + 1]);
+            // the line with the error only takes part in the check
+            if (!chunk.error_after_key || i + 1 < chunk.lines.size()) {
+                transition.next_state = states(ids[N + 1]);
+                for (int a = 0; a < N; ++a) {
+                    transition.next_letters[a] = letters(ids[N + a + 2]);
+                    char move = chunk.moves[i * N + a];
+                    transition.moves |= (move == HEAD_RIGHT  ? 1
+                                         : move == HEAD_LEFT ? 2
+                                                             : 0)
+                                        << 2 * a;
+                }
+            }
+            read.emplace_back(transition, first_line + chunk.lines[i] - 1);
+        }
+        if (chunk.error) {
+            error = std::move(chunk.error);
+            error->line += first_line - 1;
+            break;
+        }
+        first_line += chunk.num_lines - 1;
+    }
+    chunks.clear();
+
+    // the numbers become the positions in the sorted identifiers
+    CompactMachine<N> machine;
+    for (const char *state : {INITIAL_STATE, ACCEPTING_STATE, REJECTING_STATE})
+        states(state);
+    letters(BLANK);
+    for (const auto &letter : input_alphabet) letters(letter);
+    vector<uint32_t> state_id, letter_id;
+    machine.states = states.sorted(state_id);
+    machine.letters = letters.sorted(letter_id);
+    machine.input_alphabet = std::move(input_alphabet);
+    for (auto &[transition, line] : read) {
+        transition.state = state_id[transition.state];
+        transition.next_state = state_id[transition.next_state];
+        for (int a = 0; a < N; ++a) {
+            transition.letters[a] = letter_id[transition.letters[a]];
+            transition.next_letters[a] = letter_id[transition.next_letters[a]];
+        }
+    }
+
+    auto key = [](const pair<Transition, int> &entry) {
+        return tie(entry.first.state, entry.first.letters);
+    };
+    sort(read.begin(), read.end(), [&](const auto &a, const auto &b) {
+        return key(a) != key(b) ? key(a) < key(b) : a.second < b.second;
+    });
+    int repeated = INT_MAX;
+    for (size_t i = 1; i < read.size(); ++i)
+        if (key(read[i - 1]) == key(read[i]))
+            repeated = min(repeated, read[i].second);
+    if (repeated != INT_MAX)
+        throw SyntaxError{repeated, "The machine is not deterministic"};
+    if (error) throw *error;
+
+    machine.transitions.reserve(read.size());
+    for (const auto &entry : read) machine.transitions.push_back(entry.first);
+    return machine;
+}
+
+// the header takes the first two lines, the transitions start in the next one
+struct Header {
     int num_tapes;
+    vector<string> input_alphabet;
+    const char *transitions;
+    int first_line;
+};
+
+Header read_header(const string &text) {
+    Reader reader(text.data(), text.data() + text.size());
+    Header header;
+
+    // number of tapes
     if (!reader.is_next_token_available() || reader.next_token() != NUM_TAPES)
         syntax_error(reader, "\"" NUM_TAPES "\" expected");
     try {
         if (!reader.is_next_token_available()) throw 0;
-        string num_tapes_str = reader.next_token();
+        string num_tapes_str(reader.next_token());
         size_t last;
-        num_tapes = stoi(num_tapes_str, &last);
-        if (last != num_tapes_str.length() || num_tapes <= 0) throw 0;
+        header.num_tapes = stoi(num_tapes_str, &last);
+        if (last != num_tapes_str.length() || header.num_tapes <= 0) throw 0;
     } catch (...) {
         syntax_error(reader,
                      "Positive integer expected after \"" NUM_TAPES "\"");
@@ -767,70 +2424,93 @@ TuringMachine read_tm_from_file(FILE *input) {
     reader.go_to_next_line();
 
     // input alphabet
-    vector<string> input_alphabet;
     if (!reader.is_next_token_available() ||
         reader.next_token() != INPUT_ALPHABET)
         syntax_error(reader, "\"" INPUT_ALPHABET "\" expected");
     while (reader.is_next_token_available()) {
-        input_alphabet.emplace_back(read_identifier(reader));
-        if (input_alphabet.back() == BLANK)
-            syntax_error(reader, "The blank letter \"" BLANK
-                                 "\" is not allowed in the input alphabet");
+        header.input_alphabet.emplace_back(read_identifier(reader));
+        if (header.input_alphabet.back() == BLANK)
+            syntax_error(reader,
+                         "The blank letter \"" BLANK
+                         "\" is not allowed in the input alphabet");
     }
-    if (input_alphabet.empty()) syntax_error(reader, "Identifier expected");
-    reader.go_to_next_line();
+    if (header.input_alphabet.empty())
+        syntax_error(reader, "Identifier expected");
 
-    // transitions
-    transitions_t transitions;
-    while (reader.is_next_token_available()) {
-        string state_before = read_identifier(reader);
-        if (state_before == "(accept)" || state_before == "(reject)")
-            syntax_error(reader, "No transition can start in the \""
-                                     << state_before << "\" state");
+    // transitions, from the line after the input alphabet
+    header.transitions = reader.get_position();
+    if (header.transitions != text.data() + text.size()) ++header.transitions;
+    header.first_line = reader.get_line_num() + 1;
+    return header;
+}
 
-        vector<string> letters_before;
-        for (int a = 0; a < num_tapes; ++a)
-            letters_before.emplace_back(read_identifier(reader));
+string read_contents(FILE *input) {
+    assert(input);
+    string text;
+    char buffer[1 << 16];
+    for (size_t read; (read = fread(buffer, 1, sizeof buffer, input)) > 0;)
+        text.append(buffer, read);
+    assert(fclose(input) == 0);
+    return text;
+}
 
-        if (transitions.find(make_pair(state_before, letters_before)) !=
-            transitions.end())
-            syntax_error(reader, "The machine is not deterministic");
+[[noreturn]] void report(const SyntaxError &error) {
+    cerr << "Syntax error in line " << error.line << ": " << error.message
+         << "\n";
+    exit(1);
+}
 
-        string state_after = read_identifier(reader);
+}  // namespace
 
-        vector<string> letters_after;
-        for (int a = 0; a < num_tapes; ++a)
-            letters_after.emplace_back(read_identifier(reader));
+TuringMachine read_tm_from_file(FILE *input) {
+    string text = read_contents(input);
+    try {
+        Header header = read_header(text);
+        transitions_t transitions =
+            read_transitions(header.transitions, text.data() + text.size(),
+                             header.num_tapes, header.first_line);
+        return TuringMachine(header.num_tapes,
+                             std::move(header.input_alphabet),
+                             std::move(transitions));
+    } catch (const SyntaxError &error) {
+        report(error);
+    }
+}
 
-        string directions;
-        for (int a = 0; a < num_tapes; ++a) {
-            string dir;
-            if (!reader.is_next_token_available() ||
-                (dir = reader.next_token()).length() != 1 ||
-                !is_direction(dir[0]))
-                syntax_error(reader, "Move direction expected, which should be "
-                                         << HEAD_LEFT << ", " << HEAD_RIGHT
-                                         << ", or " << HEAD_STAY);
-            directions += dir;
+SimulatedMachine read_tm_for_simulation(FILE *input) {
+    string text = read_contents(input);
+    try {
+        Header header = read_header(text);
+        const char *end = text.data() + text.size();
+        switch (header.num_tapes) {
+            case 1:
+                return read_compact_transitions<1>(
+                    header.transitions, end, header.first_line,
+                    std::move(header.input_alphabet));
+            case 2:
+                return read_compact_transitions<2>(
+                    header.transitions, end, header.first_line,
+                    std::move(header.input_alphabet));
+            default:
+                transitions_t transitions =
+                    read_transitions(header.transitions, end,
+                                     header.num_tapes, header.first_line);
+                return TuringMachine(header.num_tapes,
+                                     std::move(header.input_alphabet),
+                                     std::move(transitions));
         }
-
-        if (reader.is_next_token_available())
-            syntax_error(reader, "Too many tokens in a line");
-        reader.go_to_next_line();
-
-        transitions[make_pair(state_before, letters_before)] =
-            make_tuple(state_after, letters_after, directions);
+    } catch (const SyntaxError &error) {
+        report(error);
     }
-
-    return TuringMachine(num_tapes, input_alphabet, transitions);
 }
 
 vector<string> TuringMachine::working_alphabet() const {
+    assert(!transitions.runs);
     set<string> letters(input_alphabet.begin(), input_alphabet.end());
     letters.insert(BLANK);
-    for (auto transition : transitions) {
-        auto letters_before = transition.first.second;
-        auto letters_after = get<1>(transition.second);
+    for (const auto &transition : transitions) {
+        const auto &letters_before = transition.first.second;
+        const auto &letters_after = get<1>(transition.second);
         letters.insert(letters_before.begin(), letters_before.end());
         letters.insert(letters_after.begin(), letters_after.end());
     }
@@ -838,37 +2518,47 @@ vector<string> TuringMachine::working_alphabet() const {
 }
 
 vector<string> TuringMachine::set_of_states() const {
+    assert(!transitions.runs);
     set<string> states;
     states.insert(INITIAL_STATE);
     states.insert(ACCEPTING_STATE);
     states.insert(REJECTING_STATE);
-    for (auto transition : transitions) {
+    for (const auto &transition : transitions) {
         states.insert(transition.first.first);
         states.insert(get<0>(transition.second));
     }
     return vector<string>(states.begin(), states.end());
 }
 
-static void output_vector(ostream &output, vector<string> v) {
-    for (string el : v) output << " " << el;
+static void output_vector(ostream &output, const vector<string> &v) {
+    for (const string &el : v) output << " " << el;
 }
 
 void TuringMachine::save_to_file(ostream &output) const {
     output << NUM_TAPES << " " << num_tapes << "\n" << INPUT_ALPHABET;
     output_vector(output, input_alphabet);
     output << "\n";
-    for (auto transition : transitions) {
-        output << transition.first.first;
-        output_vector(output, transition.first.second);
-        output << " " << get<0>(transition.second);
-        output_vector(output, get<1>(transition.second));
-        string directions = get<2>(transition.second);
+    auto output_transition = [&](const transitions_t::key_type &key,
+                                 const transitions_t::mapped_type &value) {
+        output << key.first;
+        output_vector(output, key.second);
+        output << " " << get<0>(value);
+        output_vector(output, get<1>(value));
+        const string &directions = get<2>(value);
         for (int a = 0; a < num_tapes; ++a) output << " " << directions[a];
         output << "\n";
-    }
+    };
+    // transitions on disk come out of the merge in the same order
+    if (transitions.runs) transitions.runs->merge(output_transition);
+    for (const auto &[key, value] : transitions) output_transition(key, value);
 }
 
 vector<string> TuringMachine::parse_input(std::string input) const {
+    return parse_word(input_alphabet, input);
+}
+
+vector<string> parse_word(const vector<string> &input_alphabet,
+                          const string &input) {
     set<string> alphabet(input_alphabet.begin(), input_alphabet.end());
     size_t pos = 0;
     vector<string> res;
@@ -880,4 +2570,5 @@ vector<string> TuringMachine::parse_input(std::string input) const {
             return vector<string>();
     }
     return res;
-}
\ No newline at end of file
+}
+
@@ -1,12 +1,15 @@
 #ifndef __TURING_MACHINE_H
 #define __TURING_MACHINE_H
 
+#include <array>
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
 #include <map>
 #include <string>
 #include <tuple>
 #include <utility>
+#include <variant>
 #include <vector>
 
 // an identifier (which can be used as a name of a letter or a state) is of the
@@ -26,9 +29,84 @@
 #define HEAD_RIGHT '>'
 #define HEAD_STAY '-'
 
+// keywords of the first two lines of a machine file
+#define NUM_TAPES "num-tapes:"
+#define INPUT_ALPHABET "input-alphabet:"
+
+// changes whenever the output of the conversion changes, so that converted
+// machines cached by an older converter are not reused
+#define CONVERSION_VERSION "1"
+
+// which variant of the conversion is produced
+struct ConversionOptions {
+    // one round trip between the heads per simulated step, the first tape's
+    // update is carried back from the second head in the state
+    bool fused = false;
+    // when nonzero the working alphabet is encoded in fixed width codewords
+    // over this many digits, the table no longer grows with the square of the
+    // alphabet at the cost of longer trips between the heads
+    unsigned codewordBase = 0;
+    // the input is left in place as the first virtual tape and the heads are
+    // marked in the letters under them, so the tape is prepared in linear time
+    bool inPlace = false;
+    // when nonzero the result is replaced by toBlocks with blocks of this
+    // many cells
+    unsigned blockSize = 0;
+    // the two to one conversion is skipped, so only blockSize applies to the
+    // machine as read
+    bool keepTapes = false;
+};
+
 typedef std::map<std::pair<std::string, std::vector<std::string>>,
                  std::tuple<std::string, std::vector<std::string>, std::string>>
-    transitions_t;
+    transition_map_t;
+
+// writes of a transition that is already there, counted per generator of the
+// conversion
+struct WriteCounts {
+    uint64_t writes = 0;
+    // the same transition written again
+    uint64_t redundant = 0;
+    // a different transition replacing the previous one
+    uint64_t conflicting = 0;
+};
+
+// called for every write through transitions_t::operator[]
+void count_write(bool added, bool changed);
+
+// the counts of the generator that is running
+WriteCounts &running_generator();
+
+// every generator that wrote a transition since the start of the program
+const std::map<std::string, WriteCounts> &write_counts();
+
+class TransitionRuns;
+
+// a map of transitions whose writes through operator[] are counted, so that a
+// generator writing the same key many times shows up in write_counts(); with
+// runs the writes go to the runs on disk, which count them the same way, and
+// the map stays empty
+struct transitions_t : transition_map_t {
+    TransitionRuns *runs = nullptr;
+
+    using transition_map_t::transition_map_t;
+    transitions_t() = default;
+    explicit transitions_t(TransitionRuns *runs_) : runs(runs_) {}
+
+    class Write {
+       public:
+        Write(transitions_t &transitions_, const key_type &key_)
+            : transitions(transitions_), key(key_) {}
+
+        Write &operator=(const mapped_type &value);
+
+       private:
+        transitions_t &transitions;
+        const key_type &key;
+    };
+
+    Write operator[](const key_type &key) { return Write(*this, key); }
+};
 
 struct TuringMachine {
     int num_tapes;
@@ -42,6 +120,7 @@ struct TuringMachine {
 
     TuringMachine(int, std::vector<std::string>, transitions_t);
 
+    // both only for transitions in memory, not in external runs
     std::vector<std::string> working_alphabet() const;
 
     std::vector<std::string> set_of_states() const;
@@ -52,7 +131,14 @@ struct TuringMachine {
     // ERROR <=> input!="" && returned_value.empty()
 
     //--------ADDED SECTION---------//
-    void twoToOne();
+    // with external runs the new transitions are written to them instead of
+    // memory, they are merged when the machine is saved
+    void twoToOne(const ConversionOptions &options = {},
+                  TransitionRuns *external = nullptr);
+    // replaces the machine with an equivalent one with the same number of
+    // tapes, whose letters are blocks of this many cells and whose every step
+    // stands for all the steps made inside the blocks under the heads
+    void toBlocks(size_t size, TransitionRuns *external = nullptr);
 };
 
 static inline std::ostream &operator<<(std::ostream &output,
@@ -63,4 +149,47 @@ static inline std::ostream &operator<<(std::ostream &output,
 
 TuringMachine read_tm_from_file(FILE *input);
 
+// a machine read only to be simulated, with the number of tapes fixed at
+// compile time: states and letters are numbered in the sorted order of their
+// identifiers and a transition is a record of a fixed size, so reading the
+// machine takes no allocation per transition
+template <int N>
+struct CompactMachine {
+    static_assert(N > 0 && N <= 4, "the moves are packed in a byte");
+
+    struct Transition {
+        uint32_t state;
+        std::array<uint32_t, N> letters;
+        uint32_t next_state;
+        std::array<uint32_t, N> next_letters;
+        // two bits per tape: 0 stays, 1 moves right, 2 moves left
+        uint8_t moves;
+
+        int move(int tape) const {
+            int bits = moves >> (2 * tape) & 3;
+            return bits == 2 ? -1 : bits;
+        }
+    };
+
+    std::vector<std::string> input_alphabet;
+    // with the initial, accepting and rejecting states
+    std::vector<std::string> states;
+    // with the input alphabet and the blank
+    std::vector<std::string> letters;
+    // in the order of transitions_t
+    std::vector<Transition> transitions;
+};
+
+// the machines with one or two tapes, which the converter reads and writes,
+// are read in the compact form, the others by read_tm_from_file; syntax errors
+// are reported the same way
+typedef std::variant<TuringMachine, CompactMachine<1>, CompactMachine<2>>
+    SimulatedMachine;
+
+SimulatedMachine read_tm_for_simulation(FILE *input);
+
+// the letters of the word, see TuringMachine::parse_input
+std::vector<std::string> parse_word(const std::vector<std::string> &alphabet,
+                                    const std::string &input);
+
 #endif